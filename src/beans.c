@@ -22,6 +22,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include <SDL.h>
 #include <SDL_image.h>
@@ -44,13 +45,47 @@
 #include "gfx_blit_func.h"
 #include "collider.h"
 #include "draw-text.h"
-#include "zoom.h"
 #include "cp-button.h"
+#include "sdl2_rect.h"
+#include "workers.h"
+#include "loader.h"
+#include "surface-cache.h"
+#include "tint.h"
+#include "digit-glyphs.h"
+#include "sdf-text.h"
+#include "text-cache.h"
+#include "sprite-cache.h"
+#include "present.h"
+#include "scaler.h"
+#include "static-layer.h"
+#include "display-list.h"
+#include "renderer.h"
+#include "triple-buffer.h"
+#include "input-queue.h"
+#include "latency-stats.h"
+#include "timing.h"
+#include "profiler.h"
+#include "perf-counters.h"
+#include "trace.h"
+#include "watchdog.h"
+#include "benchmark-stats.h"
+#include "golden.h"
 
 #define FPS (1000/24)
 #define RANDOM(x) ((int) (x ## .0 * rand () / (RAND_MAX + 1.0)))
 #define RANDOM_VAR(x) ((int) (((float) x) * rand () / (RAND_MAX + 1.0)))
 
+/* Cada cuánto revisa eventos el hilo que dibuja mientras espera un cuadro */
+#define INPUT_POLL_MS 4
+
+/* El escenario de --benchmark, en pasos de la simulación */
+#define BENCHMARK_SEED 24
+#define BENCHMARK_LEVEL 3
+#define BENCHMARK_CYCLE 240
+#define BENCHMARK_CRASH_STEP 100
+#define BENCHMARK_TRUCK_STEP 200
+#define BENCHMARK_DRAWS_PER_STEP 2
+
 #if SDL_BYTEORDER == SDL_BIG_ENDIAN
 #define RMASK 0xff000000
 #define GMASK 0x00ff0000
@@ -91,6 +126,53 @@ typedef struct _BeanBag {
 	struct _BeanBag *next;
 } BeanBag;
 
+/* Un cuadro publicado por la simulación */
+typedef struct {
+	DisplayList *list;
+	int done;
+	
+	Uint32 time; /* Inicio del paso que lo generó */
+	int follow; /* El pingüino sigue al ratón */
+	int penguinx;
+	
+	/* Para --latency-stats, en microsegundos de timing_now_us */
+	Uint64 click_time; /* Primer clic que atendió este paso, 0 si ninguno */
+	Uint64 step_us;
+	Uint64 publish_time;
+} GameFrame;
+
+/* Series de --latency-stats */
+enum {
+	LATENCY_MOUSE_TO_PRESENT = 0,
+	LATENCY_CLICK_TO_PRESENT,
+	LATENCY_SIMULATION,
+	LATENCY_FRAME_AGE,
+	LATENCY_COMPOSITE,
+	LATENCY_PRESENT,
+	
+	NUM_LATENCY_SERIES
+};
+
+const char *latency_names[NUM_LATENCY_SERIES] = {
+	"Mouse to present",
+	"Click to present",
+	"Simulation step",
+	"Step to present",
+	"Composite",
+	"Present"
+};
+
+/* Lo que comparten el hilo de la simulación y el que dibuja */
+typedef struct {
+	TripleBuffer *frames;
+	InputQueue *input;
+	SDL_sem *published;
+	SDL_sem *drawn; /* Sólo en --benchmark, para ir paso a paso */
+} GameSim;
+
+#define PLATFORM_X 0
+#define PLATFORM_Y 355
+
 /* Enumerar las imágenes */
 enum {
 	IMG_GAMEINTRO,
@@ -561,6 +643,49 @@ const char *collider_names[NUM_COLLIDERS] = {
 	"collider/oneup.col"
 };
 
+/* Escenas, cada una carga sus imágenes la primera vez que se entra */
+enum {
+	SCENE_INTRO,
+	SCENE_EXPLAIN,
+	SCENE_GAMEPLAY,
+	
+	NUM_SCENES
+};
+
+typedef struct {
+	int first, last;
+} ImageRange;
+
+typedef struct {
+	const ImageRange *ranges;
+	int penguins;
+} SceneManifest;
+
+const ImageRange scene_intro_images[] = {
+	{IMG_GAMEINTRO, IMG_PENGUIN_INTRO_FRONT},
+	{IMG_BACKGROUND, IMG_PLATAFORM},
+	{-1, -1}
+};
+
+const ImageRange scene_explain_images[] = {
+	{IMG_GAMEINTRO, IMG_GAMEINTRO},
+	{IMG_INTRO_PLATAFORM, IMG_PLATAFORM},
+	{IMG_BAG_3, IMG_BAG_3},
+	{IMG_LEFT, IMG_RIGHT},
+	{-1, -1}
+};
+
+const ImageRange scene_gameplay_images[] = {
+	{IMG_BACKGROUND, IMG_CRASH_4},
+	{-1, -1}
+};
+
+const SceneManifest scene_manifests[NUM_SCENES] = {
+	{scene_intro_images, FALSE},
+	{scene_explain_images, TRUE},
+	{scene_gameplay_images, TRUE}
+};
+
 const SDL_Color penguin_colors[18] = {
 	{0, 51, 102},
 	{51, 51, 51},
@@ -958,14 +1083,107 @@ const char *text_strings[NUM_TEXTS] = {
 	gettext_noop ("Click left mouse button when at the red platform to\ndrop off bags (if you have any)."),
 };
 
+/* Fuente, tamaño, contorno y colores de cada texto */
+enum {
+	FONT_KLICKCLACK,
+	FONT_BURBANK
+};
+
+typedef struct {
+	int font;
+	int size;
+	int outline;
+	SDL_Color foreground, background;
+} TextStyle;
+
+#define TEXT_STYLE_HUD(size, outline) {FONT_KLICKCLACK, size, outline, {255, 255, 255, 0}, {0, 0, 0, 0}}
+#define TEXT_STYLE_BLUE(font, size) {font, size, 0, {0x01, 0x34, 0x9a, 0}, {0, 0, 0, 0}}
+
+const TextStyle text_styles[NUM_TEXTS] = {
+	TEXT_STYLE_HUD (24, 2),
+	TEXT_STYLE_HUD (24, 2),
+	TEXT_STYLE_HUD (24, 2),
+	
+	TEXT_STYLE_HUD (48, 2),
+	
+	TEXT_STYLE_HUD (48, 2),
+	TEXT_STYLE_HUD (48, 2),
+	
+	TEXT_STYLE_HUD (52, 3),
+	
+	TEXT_STYLE_BLUE (FONT_KLICKCLACK, 40),
+	TEXT_STYLE_BLUE (FONT_KLICKCLACK, 24),
+	TEXT_STYLE_BLUE (FONT_KLICKCLACK, 24),
+	TEXT_STYLE_BLUE (FONT_KLICKCLACK, 24),
+	
+	TEXT_STYLE_BLUE (FONT_KLICKCLACK, 40),
+	
+	TEXT_STYLE_BLUE (FONT_BURBANK, 18),
+	TEXT_STYLE_BLUE (FONT_BURBANK, 18),
+	TEXT_STYLE_BLUE (FONT_BURBANK, 18),
+	TEXT_STYLE_BLUE (FONT_BURBANK, 18),
+};
+
+const TextStyle hud_digits_style = TEXT_STYLE_HUD (24, 2);
+
+/* Los números 3, 2, 1 de la cuenta regresiva */
+const TextStyle countdown_style = {FONT_KLICKCLACK, 196, 3, {255, 255, 0, 255}, {0, 0, 0, 255}};
+
+#define COUNTDOWN_FRAMES 20
+
+/* Números de imagen en la lista de dibujo: tipo en los bits altos */
+#define SPRITE_IMAGE(n) (0x0000 | (n))
+#define SPRITE_TEXT(n) (0x1000 | (n))
+#define SPRITE_PENGUIN(n) (0x2000 | (n))
+#define SPRITE_COUNTDOWN(n, f) (0x3000 | ((n) * COUNTDOWN_FRAMES + (f)))
+#define SPRITE_DIGIT(n) (0x4000 | (n))
+
+/* Capas de la lista de dibujo, de atrás hacia adelante */
+enum {
+	DRAW_PENGUIN = 0,
+	DRAW_PLATFORM,
+	DRAW_BAG_STACK,
+	DRAW_GAME_OVER,
+	DRAW_HUD,
+	DRAW_OBJECTS,
+	DRAW_CRASH,
+	DRAW_MESSAGES,
+	DRAW_TRUCK
+};
+
 /* Prototipos de función */
 int game_intro (void);
 int game_loop (void);
+int game_simulate (void *data);
+int truck_position (int animacion);
+void benchmark_script (InputQueue *input, Uint32 step);
+void benchmark_draw (GameSim *sim, Renderer *renderer);
 int game_explain (void);
 int game_finish (void);
 void setup (void);
 SDL_Surface * set_video_mode (unsigned flags);
-void setup_and_color_penguin (void);
+void setup_and_color_penguin (SDL_Surface **temp_penguins);
+void compose_penguin_frames (SDL_Surface **temp_penguins, SDL_Color color, SDL_Surface **frames);
+void set_penguin_color (int color);
+int load_penguin_cache (void);
+void save_penguin_cache (void);
+void scene_prefetch (int scene);
+void scene_require (int scene);
+int scene_collect (char *failed_file, int size);
+int scene_image_ready (int image);
+void loading_screen_update (int done, int total);
+void setup_progress (WorkerBatch *colliders_batch, int texts_done);
+SDFFont * get_klickclack (void);
+TTF_Font * get_burbank (void);
+SDL_Surface * render_text (int text);
+void countdown_prefetch (void);
+void countdown_collect (void);
+SDL_Surface * countdown_frame (int number, int frame);
+SDL_Surface * resolve_sprite (int sprite);
+void add_digit_sprite (void *data, int glyph, SDL_Surface *surface, int x, int y);
+void render_countdown_frame (void *data, int item);
+void load_collider (void *data, int item);
+void scene_release (int scene);
 void add_bag (int tipo);
 void delete_bag (BeanBag *p);
 int map_button_in_intro (int x, int y);
@@ -976,11 +1194,38 @@ SDL_Surface * screen;
 SDL_Surface * images[NUM_IMAGES];
 SDL_Surface * texts[NUM_TEXTS];
 SDL_Surface * penguin_images[NUM_PENGUIN_FRAMES];
+SDL_Surface * penguin_base[NUM_PENGUIN_FRAMES];
+SDL_Surface * penguin_weight[NUM_PENGUIN_FRAMES];
 int use_sound;
 Collider *colliders[NUM_COLLIDERS];
 Collider *colliders_hazard_block;
 Collider *colliders_hazard_fish[10];
 int color_penguin = 0;
+SurfaceCache *penguin_cache = NULL;
+Uint64 penguin_cache_key;
+int low_memory = FALSE;
+int video_scale = 1; /* 0 = el más grande que quepa */
+int video_filter = SCALER_NEAREST;
+int video_options = 0;
+int refresh_rate = 60;
+FILE *display_dump = NULL;
+LatencyStats *latency_stats = NULL;
+FILE *latency_log = NULL;
+int watchdog_budget = 0; /* En ms, 0 = sin watchdog */
+int benchmark_frames = 0;
+GoldenCapture *golden_capture = NULL;
+
+/* Cargas en segundo plano de las escenas */
+LoaderBatch *scene_batches[NUM_SCENES];
+int image_pending[NUM_IMAGES];
+LoaderBatch *penguins_batch = NULL;
+SDL_Surface *temp_penguins[NUM_PENGUIN_IMGS];
+int penguins_ready = FALSE;
+
+/* Pantalla de carga */
+int loading_background = FALSE;
+int loading_quit = FALSE;
+Uint32 loading_last_draw = 0;
 
 Mix_Chunk * sounds[NUM_SOUNDS];
 Mix_Music * mus_carnie;
@@ -988,13 +1233,111 @@ Mix_Music * mus_carnie;
 BeanBag *first_bag = NULL;
 BeanBag *last_bag = NULL;
 
-TTF_Font *ttf24_klickclack;
-TTF_Font *ttf196_klickclack;
+SDFFont *sdf_klickclack = NULL;
+TTF_Font *ttf18_burbank = NULL;
+DigitGlyphs *hud_digits;
+
+/* Cuadros de la cuenta regresiva, se conservan entre partidas */
+SDL_Surface *countdown_frames[3 * COUNTDOWN_FRAMES];
+WorkerBatch *countdown_batch = NULL;
+int countdown_ready = FALSE;
 
 int main (int argc, char *argv[]) {
+	int g, golden_failures = 0;
+	const char *capture_frames = NULL, *capture_dir = "golden-frames", *golden_dir = NULL;
+	
+	for (g = 1; g < argc; g++) {
+		if (strcmp (argv[g], "--low-memory") == 0) {
+			low_memory = TRUE;
+		} else if (strcmp (argv[g], "--scale") == 0 && g + 1 < argc) {
+			g++;
+			if (strcmp (argv[g], "auto") == 0) {
+				video_scale = 0;
+			} else {
+				video_scale = atoi (argv[g]);
+				if (video_scale < 1 || video_scale > PRESENT_MAX_SCALE) video_scale = 1;
+			}
+		} else if (strcmp (argv[g], "--scale-filter") == 0 && g + 1 < argc) {
+			g++;
+			if (strcmp (argv[g], "scale2x") == 0) {
+				video_filter = SCALER_SCALE2X;
+			} else {
+				video_filter = SCALER_NEAREST;
+			}
+		} else if (strcmp (argv[g], "--compose-32") == 0) {
+			video_options |= PRESENT_COMPOSE_32;
+		} else if (strcmp (argv[g], "--dither") == 0) {
+			video_options |= PRESENT_DITHER;
+		} else if (strcmp (argv[g], "--refresh-rate") == 0 && g + 1 < argc) {
+			g++;
+			refresh_rate = atoi (argv[g]);
+			if (refresh_rate < 24 || refresh_rate > 360) refresh_rate = 60;
+		} else if (strcmp (argv[g], "--latency-stats") == 0) {
+			if (latency_stats == NULL) latency_stats = latency_stats_new (NUM_LATENCY_SERIES, latency_names);
+		} else if (strcmp (argv[g], "--latency-log") == 0 && g + 1 < argc) {
+			g++;
+			latency_log = fopen (argv[g], "w");
+			if (latency_log == NULL) {
+				fprintf (stderr, _("Failed to open %s for writing\n"), argv[g]);
+			} else {
+				fprintf (latency_log, "input_us,step_us,publish_us,composite_start_us,composite_end_us,present_end_us\n");
+			}
+		} else if (strcmp (argv[g], "--watchdog") == 0) {
+			if (watchdog_budget == 0) watchdog_budget = FPS;
+		} else if (strcmp (argv[g], "--frame-budget") == 0 && g + 1 < argc) {
+			g++;
+			watchdog_budget = atoi (argv[g]);
+			if (watchdog_budget < 1) watchdog_budget = FPS;
+#ifdef ENABLE_PERF_COUNTERS
+		} else if (strcmp (argv[g], "--perf-counters") == 0) {
+			perf_counters_init ();
+#endif
+		} else if (strcmp (argv[g], "--benchmark") == 0 && g + 1 < argc) {
+			g++;
+			benchmark_frames = atoi (argv[g]);
+			if (benchmark_frames < 1) benchmark_frames = 0;
+		} else if (strcmp (argv[g], "--capture-frames") == 0 && g + 1 < argc) {
+			g++;
+			capture_frames = argv[g];
+		} else if (strcmp (argv[g], "--capture-dir") == 0 && g + 1 < argc) {
+			g++;
+			capture_dir = argv[g];
+		} else if (strcmp (argv[g], "--golden-dir") == 0 && g + 1 < argc) {
+			g++;
+			golden_dir = argv[g];
+		} else if (strcmp (argv[g], "--trace") == 0 && g + 1 < argc) {
+			g++;
+			if (trace_open (argv[g]) < 0) {
+				fprintf (stderr, _("Failed to open %s for writing\n"), argv[g]);
+			}
+		} else if (strcmp (argv[g], "--dump-display-list") == 0 && g + 1 < argc) {
+			g++;
+			display_dump = fopen (argv[g], "wb");
+			if (display_dump == NULL) {
+				fprintf (stderr, _("Failed to open %s for writing\n"), argv[g]);
+			}
+		}
+	}
+	
+#ifdef ENABLE_PROFILER
+	profiler_init ();
+#endif
+	
 	/* Recuperar las rutas del sistema */
 	initSystemPaths (argv[0]);
 	
+	if (watchdog_budget > 0 && watchdog_open (get_log_path (), watchdog_budget * 1000, 1000000 / refresh_rate) < 0) {
+		fprintf (stderr, _("Failed to open the watchdog log\n"));
+	}
+	
+	/* Las capturas usan la repetición de --benchmark */
+	if (capture_frames != NULL) {
+		golden_capture = golden_capture_new (capture_frames, capture_dir, golden_dir);
+		if (golden_capture != NULL && golden_capture_last (golden_capture) >= benchmark_frames) {
+			benchmark_frames = golden_capture_last (golden_capture) + 1;
+		}
+	}
+	
 	/* Inicializar l18n */
 	setlocale (LC_ALL, "");
 	bindtextdomain (PACKAGE, get_l10n_path ());
@@ -1014,13 +1357,34 @@ int main (int argc, char *argv[]) {
 	cp_button_start ();
 	
 	do {
-		if (game_intro () == GAME_QUIT) break;
+		/* --benchmark va directo al juego */
+		if (benchmark_frames == 0 && game_intro () == GAME_QUIT) break;
 		if (game_loop () == GAME_QUIT) break;
 		//if (game_finish () == GAME_QUIT) break;
 	} while (1 == 0);
 	
+	if (display_dump != NULL) fclose (display_dump);
+	if (latency_log != NULL) fclose (latency_log);
+	if (latency_stats != NULL) {
+		latency_stats_report (latency_stats, stdout);
+		latency_stats_free (latency_stats);
+	}
+#ifdef ENABLE_PERF_COUNTERS
+	perf_counters_report (stdout);
+#endif
+	if (golden_capture != NULL) {
+		golden_failures = golden_capture_finish (golden_capture, stdout);
+		golden_capture_free (golden_capture);
+	}
+	
+	workers_shutdown ();
+#ifdef ENABLE_PERF_COUNTERS
+	perf_counters_close ();
+#endif
+	watchdog_close ();
+	trace_close ();
 	SDL_Quit ();
-	return EXIT_SUCCESS;
+	return (golden_failures > 0) ? EXIT_FAILURE : EXIT_SUCCESS;
 }
 
 int game_intro (void) {
@@ -1114,13 +1478,20 @@ int game_intro (void) {
 	
 	SDL_BlitSurface (texts[TEXT_PLAY_GAME], NULL, screen, &rect);
 	
-	SDL_Flip (screen);
+	present_flip ();
+	
+	/* Mientras se muestra la presentación, cargar las siguientes escenas */
+	if (!low_memory) {
+		scene_prefetch (SCENE_EXPLAIN);
+		scene_prefetch (SCENE_GAMEPLAY);
+		countdown_prefetch ();
+	}
 	
 	do {
 		last_time = SDL_GetTicks ();
 		num_rects = 0;
 		
-		while (SDL_PollEvent(&event) > 0) {
+		while (present_poll_event (&event) > 0) {
 			switch (event.type) {
 				case SDL_QUIT:
 					/* Vamos a cerrar la aplicación */
@@ -1153,7 +1524,7 @@ int game_intro (void) {
 					key = event.key.keysym.sym;
 					
 					if (key == SDLK_F11 || (key == SDLK_RETURN && (event.key.keysym.mod & KMOD_ALT))) {
-						SDL_WM_ToggleFullScreen (screen);
+						present_toggle_fullscreen ();
 					}
 					if (key == SDLK_ESCAPE) {
 						done = GAME_QUIT;
@@ -1212,9 +1583,9 @@ int game_intro (void) {
 			cp_button_refresh[BUTTON_UI_PLAY_GAME] = 0;
 		}
 		
-		SDL_UpdateRects (screen, num_rects, update_rects);
+		present_update_rects (num_rects, update_rects);
 		
-		//SDL_Flip (screen);
+		//present_flip ();
 		
 		now_time = SDL_GetTicks ();
 		if (now_time < last_time + FPS) SDL_Delay(last_time + FPS - now_time);
@@ -1248,6 +1619,8 @@ int game_explain (void) {
 	Uint32 color, blanco2;
 	SDL_Surface *trans1, *trans2, *mini_p, *mini_bag, *mini_shake[6];
 	
+	scene_require (SCENE_EXPLAIN);
+	
 	color = SDL_MapRGB (screen->format, 255, 255, 255);
 	trans1 = SDL_CreateRGBSurface (SDL_SWSURFACE | SDL_SRCALPHA, texts[TEXT_NEXT_PAGE]->w, texts[TEXT_NEXT_PAGE]->h, 32, RMASK, GMASK, BMASK, AMASK);
 	trans2 = SDL_CreateRGBSurface (SDL_SWSURFACE | SDL_SRCALPHA, texts[TEXT_PLAY_GAME]->w, texts[TEXT_PLAY_GAME]->h, 32, RMASK, GMASK, BMASK, AMASK);
@@ -1255,10 +1628,11 @@ int game_explain (void) {
 	SDL_FillRect (trans1, NULL, blanco2); /* Blanco */
 	SDL_FillRect (trans2, NULL, blanco2); /* Blanco */
 	
-	mini_p = zoomSurface (penguin_images [PENGUIN_FRAME_1], 0.7654, 0.7654, 1);
-	mini_bag = zoomSurface (images[IMG_BAG_3], 0.7596, 0.7596, 1);
+	/* Las miniaturas se escalan sólo la primera vez */
+	mini_p = sprite_cache_get (penguin_images [PENGUIN_FRAME_1], 0.7654, 1);
+	mini_bag = sprite_cache_get (images[IMG_BAG_3], 0.7596, 1);
 	for (g = PENGUIN_FRAME_6_1; g <= PENGUIN_FRAME_6_6; g++) {
-		mini_shake[g - PENGUIN_FRAME_6_1] = zoomSurface (penguin_images[g], 0.7654, 0.7654, 1);
+		mini_shake[g - PENGUIN_FRAME_6_1] = sprite_cache_get (penguin_images[g], 0.7654, 1);
 	}
 	
 	/* Predibujar todo */
@@ -1315,13 +1689,13 @@ int game_explain (void) {
 	
 	SDL_BlitSurface (texts[TEXT_EXPLAIN_1], NULL, screen, &rect);
 	
-	SDL_Flip (screen);
+	present_flip ();
 	
 	do {
 		last_time = SDL_GetTicks ();
 		num_rects = 0;
 		
-		while (SDL_PollEvent(&event) > 0) {
+		while (present_poll_event (&event) > 0) {
 			/* fprintf (stdout, "Evento: %i\n", event.type);*/
 			switch (event.type) {
 				case SDL_QUIT:
@@ -1355,7 +1729,7 @@ int game_explain (void) {
 					key = event.key.keysym.sym;
 					
 					if (key == SDLK_F11 || (key == SDLK_RETURN && (event.key.keysym.mod & KMOD_ALT))) {
-						SDL_WM_ToggleFullScreen (screen);
+						present_toggle_fullscreen ();
 					}
 					if (key == SDLK_ESCAPE) {
 						done = GAME_QUIT;
@@ -1523,7 +1897,7 @@ int game_explain (void) {
 			cp_button_refresh[BUTTON_EXPLAIN_PLAY_GAME] = 0;
 		}
 		
-		SDL_UpdateRects (screen, num_rects, update_rects);
+		present_update_rects (num_rects, update_rects);
 		
 		now_time = SDL_GetTicks ();
 		if (now_time < last_time + FPS) SDL_Delay(last_time + FPS - now_time);
@@ -1532,12 +1906,6 @@ int game_explain (void) {
 	
 	SDL_FreeSurface (trans1);
 	SDL_FreeSurface (trans2);
-	SDL_FreeSurface (mini_p);
-	SDL_FreeSurface (mini_bag);
-	
-	for (g = 0; g < 6; g++) {
-		SDL_FreeSurface (mini_shake [g]);
-	}
 	
 	return done;
 }
@@ -1552,12 +1920,12 @@ int game_finish (void) {
 	
 	/* Predibujar todo */
 	SDL_FillRect (screen, NULL, 0);
-	SDL_Flip (screen);
+	present_flip ();
 	
 	do {
 		last_time = SDL_GetTicks ();
 		
-		while (SDL_PollEvent(&event) > 0) {
+		while (present_poll_event (&event) > 0) {
 			/* fprintf (stdout, "Evento: %i\n", event.type);*/
 			switch (event.type) {
 				case SDL_QUIT:
@@ -1575,7 +1943,7 @@ int game_finish (void) {
 					key = event.key.keysym.sym;
 					
 					if (key == SDLK_F11 || (key == SDLK_RETURN && (event.key.keysym.mod & KMOD_ALT))) {
-						SDL_WM_ToggleFullScreen (screen);
+						present_toggle_fullscreen ();
 					}
 					if (key == SDLK_ESCAPE) {
 						done = GAME_QUIT;
@@ -1584,7 +1952,7 @@ int game_finish (void) {
 			}
 		}
 		
-		SDL_Flip (screen);
+		present_flip ();
 		
 		now_time = SDL_GetTicks ();
 		if (now_time < last_time + FPS) SDL_Delay(last_time + FPS - now_time);
@@ -1595,7 +1963,9 @@ int game_finish (void) {
 }
 #endif
 
-int game_loop (void) {
+int game_simulate (void *data) {
+	GameSim *sim = (GameSim *) data;
+	GameFrame *frame;
 	int done = 0;
 	SDL_Event event;
 	SDLKey key;
@@ -1622,44 +1992,55 @@ int game_loop (void) {
 	int crash_anim = -1;
 	int score = 0;
 	int bag_stack = 0;
-	char buffer[20];
-	SDL_Surface *numbers[3][20];
-	double z;
-	
-	SDL_Color negro, blanco, amarillo;
-	blanco.r = blanco.g = blanco.b = 255;
-	blanco.unused = 255;
-	negro.r = negro.g = negro.b = 0;
-	negro.unused = 255;
-	amarillo.r = amarillo.g = 255;
-	amarillo.b = 0;
-	amarillo.unused = 255;
-	
-	SDL_Surface *vidas_p, *nivel_p, *score_p;
-	
-	vidas_p = draw_text_with_shadow (ttf24_klickclack, 2, "3", blanco, negro);
-	nivel_p = draw_text_with_shadow (ttf24_klickclack, 2, "1", blanco, negro);
-	score_p = draw_text_with_shadow (ttf24_klickclack, 2, "0", blanco, negro);
-	
-	/* Preparar los números en tamaño grande */
-	numbers[0][19] = draw_text_with_shadow (ttf196_klickclack, 3, "1", amarillo, negro);
-	numbers[1][19] = draw_text_with_shadow (ttf196_klickclack, 3, "2", amarillo, negro);
-	numbers[2][19] = draw_text_with_shadow (ttf196_klickclack, 3, "3", amarillo, negro);
-	
-	z = 1.0;
-	for (i = 18; i >= 0; i--) {
-		z = z - 0.016118421;
-		numbers[0][i] = zoomSurface (numbers[0][19], z, z, 1);
-		numbers[1][i] = zoomSurface (numbers[1][19], z, z, 1);
-		numbers[2][i] = zoomSurface (numbers[2][19], z, z, 1);
+	SDL_Surface *number;
+	DisplayList *list;
+	DisplayItem *item;
+	SDL_Rect platform_rect, overlap, part, reach;
+	int cruce, next_frame;
+	Uint64 step_start, event_time, click_time;
+	WatchdogFrame watch;
+	Uint32 step_number = 0;
+	
+	platform_rect.x = PLATFORM_X;
+	platform_rect.y = PLATFORM_Y;
+	platform_rect.w = images[IMG_PLATAFORM]->w;
+	platform_rect.h = images[IMG_PLATAFORM]->h;
+	
+	if (benchmark_frames > 0) {
+		/* El escenario empieza donde ya salen yunques y peces, con varias
+		 * bolsas en el aire */
+		nivel = BENCHMARK_LEVEL;
+		max_airbone = 3;
+		bag_activity = 6;
 	}
 	
-	SDL_EventState (SDL_MOUSEMOTION, SDL_IGNORE);
+	trace_thread_name ("Simulation");
+	PROFILE_START (PROFILE_TRACK_SIM);
 	
 	do {
 		last_time = SDL_GetTicks ();
+		step_start = timing_now_us ();
+		TRACE_BEGIN ("simulation step");
+		watchdog_frame_start (&watch, WATCHDOG_STEP, step_number);
+		click_time = 0;
+		
+		/* Los sucesos del escenario de --benchmark: perder una vida para
+		 * mostrar la cuenta regresiva, y llenar el camión */
+		if (benchmark_frames > 0 && try_visible == FALSE && next_level_visible == NO_NEXT_LEVEL) {
+			if (step_number % BENCHMARK_CYCLE == BENCHMARK_CRASH_STEP && bags < 6) {
+				bags = 7;
+				crash_anim = 0;
+				try_visible = TRUE;
+				animacion = 0;
+				airbone = 1000;
+			} else if (step_number % BENCHMARK_CYCLE == BENCHMARK_TRUCK_STEP && nivel < 5) {
+				/* El clic de este paso deja la última bolsa */
+				bag_stack = (nivel + 1) * 10 - 1;
+				if (bags == 0) bags = 1;
+			}
+		}
 		
-		while (SDL_PollEvent(&event) > 0) {
+		while (input_queue_pop (sim->input, &event, &event_time)) {
 			switch (event.type) {
 				case SDL_QUIT:
 					/* Vamos a cerrar la aplicación */
@@ -1668,20 +2049,15 @@ int game_loop (void) {
 				case SDL_MOUSEBUTTONDOWN:
 					/* Tengo un Mouse Down */
 					if (event.button.button != SDL_BUTTON_LEFT) break;
+					if (click_time == 0) click_time = event_time;
 					if (penguinx <= 230 && bags > 0 && bags < 6 && next_level_visible != GAME_WIN) {
 						bag_stack++;
 						bags--;
 						
 						if (next_level_visible == NO_NEXT_LEVEL) {
 							score = score + (nivel * 3);
-							SDL_FreeSurface (score_p);
-							snprintf (buffer, sizeof (buffer), "%d", score);
-							score_p = draw_text_with_shadow (ttf24_klickclack, 2, buffer, blanco, negro);
 						} else if (next_level_visible == NEXT_LEVEL) {
 							score = score + (nivel * 25);
-							SDL_FreeSurface (score_p);
-							snprintf (buffer, sizeof (buffer), "%d", score);
-							score_p = draw_text_with_shadow (ttf24_klickclack, 2, buffer, blanco, negro);
 						}
 						/* TODO: Sonido de poner bolsa */
 						
@@ -1711,9 +2087,6 @@ int game_loop (void) {
 					/* Tengo una tecla presionada */
 					key = event.key.keysym.sym;
 					
-					if (key == SDLK_F11 || (key == SDLK_RETURN && (event.key.keysym.mod & KMOD_ALT))) {
-						SDL_WM_ToggleFullScreen (screen);
-					}
 					if (key == SDLK_ESCAPE) {
 						done = GAME_QUIT;
 					}
@@ -1722,7 +2095,7 @@ int game_loop (void) {
 		}
 		
 		if (bags < 6 && next_level_visible == NO_NEXT_LEVEL) {
-			SDL_GetMouseState (&handposx, NULL);
+			input_queue_get_mouse (sim->input, &handposx, NULL, NULL);
 		
 			penguinx = handposx;
 			if (penguinx < 190) {
@@ -1732,6 +2105,9 @@ int game_loop (void) {
 			}
 		}
 		
+		PROFILE_LAP (PROFILE_SIM_INPUT);
+		watchdog_lap (&watch, WATCHDOG_INPUT);
+		
 		activator = RANDOM_VAR (bag_activity);
 		
 		if (activator <= 2 && bags < 6 /* AND Game Over not visible */) {
@@ -1762,6 +2138,9 @@ int game_loop (void) {
 			}
 		}
 		
+		PROFILE_LAP (PROFILE_SIM_SPAWN);
+		watchdog_lap (&watch, WATCHDOG_SPAWN);
+		
 		if (bags >= 0 && bags <= 6) {
 			k = COLLIDER_PENGUIN_1 + bags;
 		} else {
@@ -1769,6 +2148,8 @@ int game_loop (void) {
 		}
 		
 		/* Procesar las bolsas */
+		TRACE_BEGIN ("collider hittests");
+		PERF_BEGIN (PERF_REGION_COLLISIONS);
 		thisbag = first_bag;
 		while (thisbag != NULL) {
 			nextbag = thisbag->next;
@@ -1798,9 +2179,6 @@ int game_loop (void) {
 							animacion = 0;
 							airbone = 1000; /* El airbone bloquea que salgan más objetos */
 							vidas--;
-							SDL_FreeSurface (vidas_p);
-							snprintf (buffer, sizeof (buffer), "%d", vidas);
-							vidas_p = draw_text_with_shadow (ttf24_klickclack, 2, buffer, blanco, negro);
 							/* TODO: Reproducir aquí el sonido de golpe */
 						} else {
 							gameover_visible = TRUE;
@@ -1809,9 +2187,6 @@ int game_loop (void) {
 					} else {
 						/* Sumar solo si no crasheó al pinguino */
 						score = score + (nivel * 2);
-						SDL_FreeSurface (score_p);
-						snprintf (buffer, sizeof (buffer), "%d", score);
-						score_p = draw_text_with_shadow (ttf24_klickclack, 2, buffer, blanco, negro);
 					}
 					airbone--;
 					printf ("Airbone: %i\n", airbone);
@@ -1836,9 +2211,6 @@ int game_loop (void) {
 						airbone = 1000; /* El airbone bloquea que salgan más objetos */
 						printf ("Airbone: %i\n", airbone);
 						vidas--;
-						SDL_FreeSurface (vidas_p);
-						snprintf (buffer, sizeof (buffer), "%d", vidas);
-						vidas_p = draw_text_with_shadow (ttf24_klickclack, 2, buffer, blanco, negro);
 					} else if (try_visible == FALSE) {
 						gameover_visible = TRUE;
 						printf ("Game Over visible\n");
@@ -1857,9 +2229,6 @@ int game_loop (void) {
 				if (i == SDL_TRUE) {
 					vidas++;
 					
-					SDL_FreeSurface (vidas_p);
-					snprintf (buffer, sizeof (buffer), "%d", vidas);
-					vidas_p = draw_text_with_shadow (ttf24_klickclack, 2, buffer, blanco, negro);
 					/* TODO: Reproducir sonido boing */
 					
 					/* TODO: Mostrar la notificación de 1 vida */
@@ -1883,9 +2252,6 @@ int game_loop (void) {
 						animacion = 0;
 						airbone = 1000; /* El airbone bloquea que salgan más objetos */
 						vidas--;
-						SDL_FreeSurface (vidas_p);
-						snprintf (buffer, sizeof (buffer), "%d", vidas);
-						vidas_p = draw_text_with_shadow (ttf24_klickclack, 2, buffer, blanco, negro);
 					} else if (try_visible == FALSE) {
 						gameover_visible = TRUE;
 					}
@@ -1911,9 +2277,6 @@ int game_loop (void) {
 						animacion = 0;
 						airbone = 1000; /* El airbone bloquea que salgan más objetos */
 						vidas--;
-						SDL_FreeSurface (vidas_p);
-						snprintf (buffer, sizeof (buffer), "%d", vidas);
-						vidas_p = draw_text_with_shadow (ttf24_klickclack, 2, buffer, blanco, negro);
 					} else if (try_visible == FALSE) {
 						gameover_visible = TRUE;
 					}
@@ -1953,8 +2316,16 @@ int game_loop (void) {
 			
 			thisbag = nextbag;
 		}
+		PERF_END (PERF_REGION_COLLISIONS);
+		TRACE_END ("collider hittests");
 		
-		SDL_BlitSurface (images[IMG_BACKGROUND], NULL, screen, NULL);
+		PROFILE_LAP (PROFILE_SIM_UPDATE);
+		watchdog_lap (&watch, WATCHDOG_UPDATE);
+		
+		/* El cuadro se anota en el espacio libre del triple búfer */
+		frame = (GameFrame *) triple_buffer_back (sim->frames);
+		list = frame->list;
+		display_list_clear (list);
 		
 		if (bags >= 0 && bags < 4) {
 			i = PENGUIN_FRAME_1 + bags;
@@ -1984,15 +2355,29 @@ int game_loop (void) {
 		rect.w = penguin_images[i]->w;
 		rect.h = penguin_images[i]->h;
 		
-		SDL_BlitSurface (penguin_images[i], NULL, screen, &rect);
+		/* La capa ya trae la plataforma, donde la puede cruzar el pingüino
+		 * se regresa sólo el fondo. El pingüino sigue al ratón entre pasos,
+		 * así que el cruce se calcula sobre todo su recorrido (de 190 a 555)
+		 * y el fondo y la plataforma se quedan fijos */
+		reach = rect;
+		reach.x = 190 - 120;
+		reach.w = (555 - 190) + rect.w;
+		cruce = SDL_IntersectRect (&reach, &platform_rect, &overlap);
+		if (cruce) {
+			display_list_add_part (list, DRAW_PENGUIN, SPRITE_IMAGE (IMG_BACKGROUND), &overlap, overlap.x, overlap.y);
+		}
 		
-		/* Dibujar la plataforma */
-		rect.x = 0;
-		rect.y = 355;
-		rect.w = images[IMG_PLATAFORM]->w;
-		rect.h = images[IMG_PLATAFORM]->h;
+		item = display_list_add (list, DRAW_PENGUIN, SPRITE_PENGUIN (i), rect.x, rect.y);
+		display_item_follow (item);
 		
-		SDL_BlitSurface (images[IMG_PLATAFORM], NULL, screen, &rect);
+		/* Dibujar la plataforma, sólo la parte que puede quedar encima del pingüino */
+		if (cruce) {
+			part = overlap;
+			part.x -= platform_rect.x;
+			part.y -= platform_rect.y;
+			
+			display_list_add_part (list, DRAW_PLATFORM, SPRITE_IMAGE (IMG_PLATAFORM), &part, overlap.x, overlap.y);
+		}
 		
 		/* Dibujar la pila de bolsas de café, arriba de la plataforma, por detrás del camión */
 		if (bag_stack > 0) {
@@ -2009,7 +2394,7 @@ int game_loop (void) {
 			rect.w = images[i]->w;
 			rect.h = images[i]->h;
 			
-			SDL_BlitSurface (images[i], NULL, screen, &rect);
+			display_list_add (list, DRAW_BAG_STACK, SPRITE_IMAGE (i), rect.x, rect.y);
 		}
 		
 		if (gameover_visible == TRUE) {
@@ -2019,51 +2404,16 @@ int game_loop (void) {
 			rect.x = 365 - (rect.w / 2);
 			rect.y = 145;
 			
-			SDL_BlitSurface (texts[TEXT_GAME_OVER], NULL, screen, &rect);
+			display_list_add (list, DRAW_GAME_OVER, SPRITE_TEXT (TEXT_GAME_OVER), rect.x, rect.y);
 		}
 		
-		/* Los mensajes de texto van antes de las bolsas */
-		rect.x = 30;
-		rect.y = 8;
-		rect.w = texts[TEXT_LIVES]->w;
-		rect.h = texts[TEXT_LIVES]->h;
-		
-		SDL_BlitSurface (texts[TEXT_LIVES], NULL, screen, &rect);
-		
-		rect.x = 30 + texts[TEXT_LIVES]->w + 2;
-		rect.y = 8;
-		rect.w = vidas_p->w;
-		rect.h = vidas_p->h;
-		
-		SDL_BlitSurface (vidas_p, NULL, screen, &rect);
-		
-		rect.x = 216;
-		rect.y = 8;
-		rect.w = texts[TEXT_TRUCKS]->w;
-		rect.h = texts[TEXT_TRUCKS]->h;
-		
-		SDL_BlitSurface (texts[TEXT_TRUCKS], NULL, screen, &rect);
-		
-		rect.x = 216 + texts[TEXT_TRUCKS]->w + 5;
-		rect.y = 8;
-		rect.w = nivel_p->w;
-		rect.h = nivel_p->h;
-		
-		SDL_BlitSurface (nivel_p, NULL, screen, &rect);
-		
-		rect.x = 390;
-		rect.y = 8;
-		rect.w = texts[TEXT_SCORE]->w;
-		rect.h = texts[TEXT_SCORE]->h;
-		
-		SDL_BlitSurface (texts[TEXT_SCORE], NULL, screen, &rect);
+		/* Los mensajes de texto van antes de las bolsas, las etiquetas ya
+		 * vienen en la capa fija */
+		digit_glyphs_foreach (hud_digits, vidas, 30 + texts[TEXT_LIVES]->w + 2, 8, add_digit_sprite, list);
 		
-		rect.x = 390 + texts[TEXT_SCORE]->w + 5;
-		rect.h = 8;
-		rect.w = score_p->w;
-		rect.h = score_p->h;
+		digit_glyphs_foreach (hud_digits, nivel, 216 + texts[TEXT_TRUCKS]->w + 5, 8, add_digit_sprite, list);
 		
-		SDL_BlitSurface (score_p, NULL, screen, &rect);
+		digit_glyphs_foreach (hud_digits, score, 390 + texts[TEXT_SCORE]->w + 5, 8, add_digit_sprite, list);
 		
 		/* Dibujar los objetos en pantalla */
 		thisbag = first_bag;
@@ -2086,10 +2436,14 @@ int game_loop (void) {
 				rect.h = images[i]->h;
 			
 				if (i == IMG_BAG_4 && j > 25) {
-					SDL_gfxBlitRGBAWithAlpha (images[i], NULL, screen, &rect, 255 - SDL_ALPHA_OPAQUE * (j - 25) / 10);
+					item = display_list_add_alpha (list, DRAW_OBJECTS, SPRITE_IMAGE (i), rect.x, rect.y, 255 - SDL_ALPHA_OPAQUE * (j - 25) / 10);
 				} else {
-					SDL_BlitSurface (images[i], NULL, screen, &rect);
+					item = display_list_add (list, DRAW_OBJECTS, SPRITE_IMAGE (i), rect.x, rect.y);
 				}
+				
+				/* Hacia dónde va en el siguiente paso */
+				next_frame = (thisbag->frame < thisbag->throw_length ? thisbag->frame + 1 : thisbag->throw_length);
+				display_item_move (item, thisbag->bag_points[next_frame][1], thisbag->bag_points[next_frame][2]);
 			} else if (thisbag->bag == 5) {
 				/* Dibujar un yunque */
 				if (thisbag->frame < thisbag->throw_length) {
@@ -2108,10 +2462,13 @@ int game_loop (void) {
 				rect.h = images[i]->h;
 				
 				if (i == IMG_ANVIL_23 && j > 25) {
-					SDL_gfxBlitRGBAWithAlpha (images[i], NULL, screen, &rect, 255 - SDL_ALPHA_OPAQUE * (j - 25) / 10);
+					item = display_list_add_alpha (list, DRAW_OBJECTS, SPRITE_IMAGE (i), rect.x, rect.y, 255 - SDL_ALPHA_OPAQUE * (j - 25) / 10);
 				} else {
-					SDL_BlitSurface (images[i], NULL, screen, &rect);
+					item = display_list_add (list, DRAW_OBJECTS, SPRITE_IMAGE (i), rect.x, rect.y);
 				}
+				
+				next_frame = (thisbag->frame + 1 < thisbag->throw_length ? thisbag->frame + 1 : 23);
+				display_item_move (item, thisbag->object_points[next_frame][0], thisbag->object_points[next_frame][1]);
 			} else if (thisbag->bag == 4) {
 				/* Dibujar la vida */
 				i = IMG_ONEUP;
@@ -2120,7 +2477,10 @@ int game_loop (void) {
 				rect.w = images[i]->w;
 				rect.h = images[i]->h;
 				
-				SDL_BlitSurface (images[i], NULL, screen, &rect);
+				item = display_list_add (list, DRAW_OBJECTS, SPRITE_IMAGE (i), rect.x, rect.y);
+				
+				next_frame = (thisbag->frame + 1 < thisbag->throw_length ? thisbag->frame + 1 : thisbag->frame);
+				display_item_move (item, thisbag->object_points[next_frame][0], thisbag->object_points[next_frame][1]);
 			} else if (thisbag->bag == 6) {
 				if (thisbag->frame < thisbag->throw_length) {
 					i = IMG_FISH;
@@ -2136,10 +2496,13 @@ int game_loop (void) {
 				rect.h = images[i]->h;
 				
 				if (i == IMG_FISH_DROPPED && j > 25) {
-					SDL_gfxBlitRGBAWithAlpha (images[i], NULL, screen, &rect, 255 - SDL_ALPHA_OPAQUE * (j - 25) / 10);
+					item = display_list_add_alpha (list, DRAW_OBJECTS, SPRITE_IMAGE (i), rect.x, rect.y, 255 - SDL_ALPHA_OPAQUE * (j - 25) / 10);
 				} else {
-					SDL_BlitSurface (images[i], NULL, screen, &rect);
+					item = display_list_add (list, DRAW_OBJECTS, SPRITE_IMAGE (i), rect.x, rect.y);
 				}
+				
+				next_frame = (thisbag->frame + 1 < thisbag->throw_length ? thisbag->frame + 1 : 34);
+				display_item_move (item, thisbag->object_points[next_frame][0], thisbag->object_points[next_frame][1]);
 			} else if (thisbag->bag == 7) {
 				if (thisbag->frame < thisbag->throw_length) {
 					i = IMG_FLOWER;
@@ -2155,10 +2518,13 @@ int game_loop (void) {
 				rect.h = images[i]->h;
 				
 				if (i == IMG_FLOWER_DROPPED && j > 25) {
-					SDL_gfxBlitRGBAWithAlpha (images[i], NULL, screen, &rect, 255 - SDL_ALPHA_OPAQUE * (j - 25) / 10);
+					item = display_list_add_alpha (list, DRAW_OBJECTS, SPRITE_IMAGE (i), rect.x, rect.y, 255 - SDL_ALPHA_OPAQUE * (j - 25) / 10);
 				} else {
-					SDL_BlitSurface (images[i], NULL, screen, &rect);
+					item = display_list_add (list, DRAW_OBJECTS, SPRITE_IMAGE (i), rect.x, rect.y);
 				}
+				
+				next_frame = (thisbag->frame + 1 < thisbag->throw_length ? thisbag->frame + 1 : 31);
+				display_item_move (item, thisbag->object_points[next_frame][0], thisbag->object_points[next_frame][1]);
 			}
 			
 			thisbag = thisbag->next;
@@ -2175,7 +2541,7 @@ int game_loop (void) {
 			rect.w = images[i]->w;
 			rect.h = images[i]->h;
 			
-			SDL_BlitSurface (images[i], NULL, screen, &rect);
+			display_list_add (list, DRAW_CRASH, SPRITE_IMAGE (i), rect.x, rect.y);
 			
 			crash_anim++;
 			
@@ -2188,7 +2554,7 @@ int game_loop (void) {
 			rect.x = 388 - (rect.w / 2);
 			rect.y = 126;
 			
-			SDL_BlitSurface (texts[TEXT_TRY_AGAIN], NULL, screen, &rect);
+			display_list_add (list, DRAW_MESSAGES, SPRITE_TEXT (TEXT_TRY_AGAIN), rect.x, rect.y);
 			
 			/* Poner el número 3, 2, 1 */
 			i = -1;
@@ -2203,12 +2569,13 @@ int game_loop (void) {
 				i = 0;
 			}
 			
-			if (i >= 0) {
-				rect.w = numbers[i][j]->w;
-				rect.h = numbers[i][j]->h;
+			if (i >= 0 && (number = countdown_frame (i, j)) != NULL) {
+				rect.w = number->w;
+				rect.h = number->h;
 				rect.x = 371 - (rect.w / 2);
 				rect.y = 122 - j;
-				SDL_gfxBlitRGBAWithAlpha (numbers[i][j], NULL, screen, &rect, (255 - (12.75 * ((float) j))));
+				item = display_list_add_alpha (list, DRAW_MESSAGES, SPRITE_COUNTDOWN (i, j), rect.x, rect.y, (Uint8) (255 - (12.75 * ((float) j))));
+				if (j + 1 < COUNTDOWN_FRAMES) display_item_move (item, rect.x, rect.y - 1);
 			}
 			
 			animacion++;
@@ -2223,7 +2590,7 @@ int game_loop (void) {
 				rect.x = 388 - (rect.w / 2);
 				rect.y = 115;
 				
-				SDL_BlitSurface (texts[TEXT_UNLOADED], NULL, screen, &rect);
+				display_list_add (list, DRAW_MESSAGES, SPRITE_TEXT (TEXT_UNLOADED), rect.x, rect.y);
 			} else if (animacion > 62) {
 				rect.w = texts[TEXT_NEXT_TRUCK]->w;
 				rect.h = texts[TEXT_NEXT_TRUCK]->h;
@@ -2231,23 +2598,16 @@ int game_loop (void) {
 				rect.x = 378 - (rect.w / 2);
 				rect.y = 121;
 				
-				SDL_BlitSurface (texts[TEXT_NEXT_TRUCK], NULL, screen, &rect);
+				display_list_add (list, DRAW_MESSAGES, SPRITE_TEXT (TEXT_NEXT_TRUCK), rect.x, rect.y);
 			}
 			
-			if (animacion < 36) {
-				rect.x = 568 + (198 * animacion) / 36;
-			} else if (animacion >= 36 && animacion < 60) {
-				rect.x = 766; /* Fuera, no dibuja */
-			} else if (animacion >= 60 && animacion < 77) {
-				rect.x = 646 + (120 * (77 - animacion)) / 16;
-			} else if (animacion >= 77) {
-				rect.x = 568 + (78 * (97 - animacion)) / 20;
-			}
+			rect.x = truck_position (animacion);
 			rect.y = 72;
 			rect.w = images[IMG_TRUCK]->w;
 			rect.h = images[IMG_TRUCK]->h;
 			
-			SDL_BlitSurface (images[IMG_TRUCK], NULL, screen, &rect);
+			item = display_list_add (list, DRAW_TRUCK, SPRITE_IMAGE (IMG_TRUCK), rect.x, rect.y);
+			display_item_move (item, truck_position (animacion + 1), rect.y);
 			animacion++;
 		} else {
 			/* Dibujar el camión normal */
@@ -2256,10 +2616,22 @@ int game_loop (void) {
 			rect.w = images[IMG_TRUCK]->w;
 			rect.h = images[IMG_TRUCK]->h;
 	
-			SDL_BlitSurface (images[IMG_TRUCK], NULL, screen, &rect);
+			display_list_add (list, DRAW_TRUCK, SPRITE_IMAGE (IMG_TRUCK), rect.x, rect.y);
 		}
 		
-		SDL_Flip (screen);
+		if (display_dump != NULL) display_list_write (list, display_dump);
+		
+		frame->done = done;
+		frame->time = last_time;
+		frame->follow = (bags < 6 && next_level_visible == NO_NEXT_LEVEL);
+		frame->penguinx = penguinx;
+		frame->click_time = click_time;
+		frame->publish_time = timing_now_us ();
+		frame->step_us = frame->publish_time - step_start;
+		triple_buffer_publish (sim->frames);
+		SDL_SemPost (sim->published);
+		PROFILE_LAP (PROFILE_SIM_EMIT);
+		watchdog_lap (&watch, WATCHDOG_EMIT);
 		
 		if (try_visible == TRUE && animacion >= 92) {
 			/* Continuar nivel */
@@ -2280,9 +2652,6 @@ int game_loop (void) {
 			
 			nivel++;
 			
-			SDL_FreeSurface (nivel_p);
-			snprintf (buffer, sizeof (buffer), "%d", nivel);
-			nivel_p = draw_text_with_shadow (ttf24_klickclack, 2, buffer, blanco, negro);
 			airbone = 0;
 			
 			bag_stack = 0;
@@ -2292,29 +2661,378 @@ int game_loop (void) {
 			next_level_visible = NO_NEXT_LEVEL;
 		}
 		
-		now_time = SDL_GetTicks ();
-		if (now_time < last_time + FPS) SDL_Delay(last_time + FPS - now_time);
+		PROFILE_LAP (PROFILE_SIM_UPDATE);
+		watchdog_lap (&watch, WATCHDOG_UPDATE);
+		TRACE_END ("simulation step");
+		
+		/* Anotar el paso si se pasó del presupuesto, con el estado del juego */
+		if (watchdog_frame_slow (&watch)) {
+			watch.objects = 0;
+			for (thisbag = first_bag; thisbag != NULL; thisbag = thisbag->next) {
+				watch.objects++;
+			}
+			watch.level = nivel;
+			watch.airbone = airbone;
+			watch.bags = bags;
+			watchdog_report (&watch);
+		}
+		
+		if (sim->drawn != NULL) {
+			/* En --benchmark no se espera, pero cada paso se dibuja antes
+			 * de empezar el siguiente */
+			SDL_SemWait (sim->drawn);
+		} else {
+			now_time = SDL_GetTicks ();
+			if (now_time < last_time + FPS) SDL_Delay(last_time + FPS - now_time);
+		}
+		PROFILE_LAP (PROFILE_SIM_SLEEP);
+		PROFILE_COMMIT (PROFILE_TRACK_SIM);
+		step_number++;
 		
 	} while (!done);
 	
-	/* Liberar los números usados */
-	for (i = 0; i < 3; i++) {
-		for (j = 0; j < 20; j++) {
-			SDL_FreeSurface (numbers[i][j]);
+	return done;
+}
+
+/* Posición del camión en la animación de cambio de nivel */
+int truck_position (int animacion) {
+	if (animacion < 36) {
+		return 568 + (198 * animacion) / 36;
+	} else if (animacion < 60) {
+		return 766; /* Fuera, el dibujante lo descarta */
+	} else if (animacion < 77) {
+		return 646 + (120 * (77 - animacion)) / 16;
+	}
+	
+	return 568 + (78 * (97 - animacion)) / 20;
+}
+
+/* La entrada de --benchmark: el pingüino va y viene, deja las bolsas cada
+ * vez que pasa por la plataforma y se queda ahí antes de llenar el camión */
+void benchmark_script (InputQueue *input, Uint32 step) {
+	SDL_Event event;
+	int x, t;
+	
+	t = step % BENCHMARK_CYCLE;
+	if (t >= BENCHMARK_TRUCK_STEP - 10 && t <= BENCHMARK_TRUCK_STEP) {
+		x = 190;
+	} else {
+		t = step % 96;
+		x = 190 + (365 * (t < 48 ? t : 96 - t)) / 48;
+	}
+	
+	input_queue_set_mouse (input, x, 300);
+	
+	if (x <= 230) {
+		memset (&event, 0, sizeof (event));
+		event.type = SDL_MOUSEBUTTONDOWN;
+		event.button.button = SDL_BUTTON_LEFT;
+		event.button.x = x;
+		event.button.y = 300;
+		input_queue_push (input, &event);
+	}
+}
+
+/* El dibujante de --benchmark: sin esperar al reloj, cada paso se dibuja
+ * BENCHMARK_DRAWS_PER_STEP veces en distintas fases */
+void benchmark_draw (GameSim *sim, Renderer *renderer) {
+	BenchmarkStats *stats;
+	GameFrame *frame;
+	SDL_Event event;
+	SDL_Rect *dirty;
+	FILE *timings;
+	Uint64 start, elapsed, frame_start, capture_start, capture_us = 0;
+	Uint32 step = 0;
+	int g, n_dirty, drawn = 0, done = 0;
+	
+	stats = benchmark_stats_new (benchmark_frames);
+	if (stats == NULL) {
+		fprintf (stderr, _("Out of memory\n"));
+		SDL_Quit ();
+		exit (1);
+	}
+	
+	start = timing_now_us ();
+	
+	while (!done) {
+		SDL_SemWait (sim->published);
+		triple_buffer_acquire (sim->frames, (void **) &frame);
+		done = frame->done;
+		
+		/* Cerrar la ventana termina antes */
+		while (present_poll_event (&event) > 0) {
+			if (event.type == SDL_QUIT || (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_ESCAPE)) {
+				drawn = benchmark_frames;
+			}
+		}
+		
+		for (g = 0; g < BENCHMARK_DRAWS_PER_STEP && drawn < benchmark_frames && !done; g++) {
+			TRACE_BEGIN ("frame");
+			frame_start = timing_now_us ();
+			n_dirty = renderer_draw (renderer, frame->list, g * DISPLAY_PHASE_ONE / BENCHMARK_DRAWS_PER_STEP, 0, &dirty);
+			if (n_dirty > 0) present_update_rects (n_dirty, dirty);
+			benchmark_stats_add (stats, timing_now_us () - frame_start);
+			TRACE_END ("frame");
+			
+			/* La captura no cuenta en los tiempos */
+			if (golden_capture != NULL && golden_capture_wants (golden_capture, drawn)) {
+				capture_start = timing_now_us ();
+				golden_capture_frame (golden_capture, drawn, screen);
+				capture_us += timing_now_us () - capture_start;
+			}
+			drawn++;
+		}
+		
+		step++;
+		if (drawn >= benchmark_frames && !done) {
+			memset (&event, 0, sizeof (event));
+			event.type = SDL_QUIT;
+			input_queue_push (sim->input, &event);
+		} else {
+			benchmark_script (sim->input, step);
+		}
+		
+		SDL_SemPost (sim->drawn);
+	}
+	
+	elapsed = timing_now_us () - start - capture_us;
+	benchmark_stats_report (stats, elapsed, stdout);
+	if (golden_capture != NULL && (timings = golden_capture_timings (golden_capture)) != NULL) {
+		benchmark_stats_report (stats, elapsed, timings);
+		fclose (timings);
+	}
+	benchmark_stats_free (stats);
+}
+
+int game_loop (void) {
+	SDL_Event event;
+	SDLKey key;
+	SDL_Thread *thread;
+	GameSim sim;
+	GameFrame frames[3], *frame;
+	StaticLayer *layer;
+	Renderer *renderer;
+	SDL_Rect *dirty;
+	int g, n_dirty, x, y, phase, follow_dx, wait;
+	Uint32 now_time, start_time, draws = 0;
+	Uint64 input_time, composite_start, composite_end, present_end;
+	WatchdogFrame watch;
+	Uint32 draw_number = 0;
+	int done = 0, fresh = FALSE;
+#ifdef ENABLE_PROFILER
+	SDL_Rect overlay;
+#endif
+	
+	scene_require (SCENE_GAMEPLAY);
+	
+	/* La simulación no debe esperar a los hilos ni escribir en disco a la
+	 * mitad de un paso, así que la cuenta regresiva queda lista antes de
+	 * arrancarla. Normalmente ya se dibujó durante la presentación */
+	countdown_prefetch ();
+	countdown_collect ();
+	
+	/* Fondo, plataforma y etiquetas del marcador en una sola capa */
+	layer = static_layer_new (screen);
+	
+	/* La lógica anota el cuadro en la lista, el dibujante lo pinta sobre
+	 * la capa fija y sólo redibuja las partes que cambiaron */
+	renderer = renderer_new (screen, layer, resolve_sprite);
+	
+	for (g = 0; g < 3; g++) {
+		frames[g].list = display_list_new ();
+		frames[g].done = 0;
+	}
+	
+	sim.frames = triple_buffer_new (&frames[0], &frames[1], &frames[2]);
+	sim.input = input_queue_new ();
+	sim.published = SDL_CreateSemaphore (0);
+	sim.drawn = (benchmark_frames > 0) ? SDL_CreateSemaphore (0) : NULL;
+	
+	if (layer == NULL || renderer == NULL || frames[0].list == NULL || frames[1].list == NULL || frames[2].list == NULL || sim.frames == NULL || sim.input == NULL || sim.published == NULL || (benchmark_frames > 0 && sim.drawn == NULL)) {
+		fprintf (stderr, _("Out of memory\n"));
+		SDL_Quit ();
+		exit (1);
+	}
+	
+	static_layer_set (layer, 0, images[IMG_BACKGROUND], 0, 0);
+	static_layer_set (layer, 1, images[IMG_PLATAFORM], PLATFORM_X, PLATFORM_Y);
+	static_layer_set (layer, 2, texts[TEXT_LIVES], 30, 8);
+	static_layer_set (layer, 3, texts[TEXT_TRUCKS], 216, 8);
+	static_layer_set (layer, 4, texts[TEXT_SCORE], 390, 8);
+	
+	SDL_EventState (SDL_MOUSEMOTION, SDL_IGNORE);
+	
+	present_get_mouse_state (&x, &y);
+	input_queue_set_mouse (sim.input, x, y);
+	if (benchmark_frames > 0) benchmark_script (sim.input, 0);
+	
+	/* La simulación corre en su propio hilo, éste recibe los eventos de SDL
+	 * y dibuja el cuadro más reciente que la simulación haya publicado */
+	thread = SDL_CreateThread (game_simulate, &sim);
+	if (thread == NULL) {
+		fprintf (stderr, _("Failed to start the game thread\n"));
+		SDL_Quit ();
+		exit (1);
+	}
+	
+	/* La simulación sigue a 24 pasos por segundo, los cuadros se dibujan a
+	 * refresh_rate moviendo los objetos entre un paso y el siguiente */
+	frame = NULL;
+	start_time = SDL_GetTicks ();
+	PROFILE_START (PROFILE_TRACK_DRAW);
+	
+	if (benchmark_frames > 0) {
+		benchmark_draw (&sim, renderer);
+		done = GAME_QUIT;
+	}
+	
+	while (!done) {
+		now_time = SDL_GetTicks ();
+		wait = (int) (start_time + (draws * 1000) / refresh_rate - now_time);
+		if (wait > INPUT_POLL_MS) wait = INPUT_POLL_MS;
+		if (wait > 0) SDL_SemWaitTimeout (sim.published, wait);
+		PROFILE_LAP (PROFILE_DRAW_WAIT);
+		watchdog_frame_start (&watch, WATCHDOG_DRAW, draw_number);
+		
+		while (present_poll_event (&event) > 0) {
+			if (event.type == SDL_KEYDOWN) {
+				key = event.key.keysym.sym;
+				
+				if (key == SDLK_F11 || (key == SDLK_RETURN && (event.key.keysym.mod & KMOD_ALT))) {
+					present_toggle_fullscreen ();
+					renderer_invalidate (renderer);
+					continue;
+				}
+#ifdef ENABLE_PROFILER
+				if (key == SDLK_F3) {
+					profiler_toggle ();
+					continue;
+				}
+#endif
+			}
+			
+			input_queue_push (sim.input, &event);
+		}
+		
+		present_get_mouse_state (&x, &y);
+		input_queue_set_mouse (sim.input, x, y);
+		
+		if (triple_buffer_acquire (sim.frames, (void **) &frame)) {
+			done = frame->done;
+			fresh = TRUE;
+		}
+		PROFILE_LAP (PROFILE_DRAW_EVENTS);
+		
+		now_time = SDL_GetTicks ();
+		if (frame == NULL || (Sint32) (now_time - (start_time + (draws * 1000) / refresh_rate)) < 0) continue;
+		
+		/* Leer el ratón justo antes de componer, no al inicio de la vuelta */
+		SDL_PumpEvents ();
+		present_get_mouse_state (&x, &y);
+		input_queue_set_mouse (sim.input, x, y);
+		input_time = timing_now_us ();
+		PROFILE_LAP (PROFILE_DRAW_EVENTS);
+		watchdog_lap (&watch, WATCHDOG_EVENTS);
+		
+		phase = (now_time - frame->time) * DISPLAY_PHASE_ONE / FPS;
+		if (phase > DISPLAY_PHASE_ONE) phase = DISPLAY_PHASE_ONE;
+		
+		/* El pingüino va donde está el ratón ahora, no donde estaba al
+		 * empezar el paso */
+		follow_dx = 0;
+		if (frame->follow) {
+			if (x < 190) {
+				x = 190;
+			} else if (x > 555) {
+				x = 555;
+			}
+			follow_dx = x - frame->penguinx;
+		}
+		
+		TRACE_BEGIN ("frame");
+		composite_start = timing_now_us ();
+		n_dirty = renderer_draw (renderer, frame->list, phase, follow_dx, &dirty);
+		composite_end = timing_now_us ();
+		
+#ifdef ENABLE_PROFILER
+		/* El overlay va directo a la pantalla, esa parte se restaura en el
+		 * siguiente cuadro */
+		if (profiler_draw_overlay (screen, &overlay)) {
+			renderer_invalidate_rect (renderer, &overlay);
+		} else {
+			overlay.w = overlay.h = 0;
+		}
+		PROFILE_LAP (PROFILE_DRAW_OVERLAY);
+#endif
+		watchdog_lap (&watch, WATCHDOG_RENDER);
+		
+		if (n_dirty > 0) present_update_rects (n_dirty, dirty);
+#ifdef ENABLE_PROFILER
+		if (overlay.w > 0) present_update_rects (1, &overlay);
+#endif
+		present_end = timing_now_us ();
+		TRACE_END ("frame");
+		PROFILE_LAP (PROFILE_DRAW_PRESENT);
+		PROFILE_COMMIT (PROFILE_TRACK_DRAW);
+		watchdog_lap (&watch, WATCHDOG_PRESENT);
+		
+		/* Los tirones que se ven vienen de aquí, no sólo de la simulación */
+		if (watchdog_frame_slow (&watch)) {
+			watch.items = frame->list->count;
+			watch.dirty = n_dirty;
+			watchdog_report (&watch);
+		}
+		draw_number++;
+		
+		if (latency_stats != NULL) {
+			latency_stats_add (latency_stats, LATENCY_MOUSE_TO_PRESENT, present_end - input_time);
+			latency_stats_add (latency_stats, LATENCY_COMPOSITE, composite_end - composite_start);
+			latency_stats_add (latency_stats, LATENCY_PRESENT, present_end - composite_end);
+			
+			/* Lo del paso sólo la primera vez que se presenta */
+			if (fresh) {
+				latency_stats_add (latency_stats, LATENCY_SIMULATION, frame->step_us);
+				latency_stats_add (latency_stats, LATENCY_FRAME_AGE, present_end - frame->publish_time);
+				if (frame->click_time != 0) latency_stats_add (latency_stats, LATENCY_CLICK_TO_PRESENT, present_end - frame->click_time);
+			}
+		}
+		
+		if (latency_log != NULL) {
+			fprintf (latency_log, "%llu,%llu,%llu,%llu,%llu,%llu\n", (unsigned long long) input_time, (unsigned long long) frame->step_us, (unsigned long long) frame->publish_time, (unsigned long long) composite_start, (unsigned long long) composite_end, (unsigned long long) present_end);
+		}
+		fresh = FALSE;
+		
+		/* Si el dibujo se atrasó, no intentar alcanzar los cuadros perdidos */
+		draws++;
+		if ((Sint32) (now_time - (start_time + (draws * 1000) / refresh_rate)) > 1000 / refresh_rate) {
+			start_time = now_time;
+			draws = 0;
 		}
 	}
 	
+	SDL_WaitThread (thread, NULL);
+	
+	SDL_DestroySemaphore (sim.published);
+	if (sim.drawn != NULL) SDL_DestroySemaphore (sim.drawn);
+	input_queue_free (sim.input);
+	triple_buffer_free (sim.frames);
+	for (g = 0; g < 3; g++) {
+		display_list_free (frames[g].list);
+	}
+	renderer_free (renderer);
+	static_layer_free (layer);
+	
 	return done;
 }
 /* Set video mode: */
 /* Mattias Engdegard <f91-men@nada.kth.se> */
 SDL_Surface * set_video_mode (unsigned flags) {
-	/* Prefer 16bpp, but also prefer native modes to emulated 16bpp. */
-
-	int depth;
-
-	depth = SDL_VideoModeOK (760, 480, 16, flags);
-	return depth ? SDL_SetVideoMode (760, 480, depth, flags) : NULL;
+	/* El juego siempre dibuja a 760x480, la ventana puede ser más grande */
+	if (video_scale == 0) {
+		video_scale = present_auto_scale (760, 480);
+	}
+	
+	return present_set_video_mode (760, 480, video_scale, video_filter, video_options, flags);
 }
 
 void setup (void) {
@@ -2322,10 +3040,16 @@ void setup (void) {
 	int g;
 	char buffer_file[8192];
 	char *systemdata_path = get_systemdata_path ();
-	Collider *c;
-	TTF_Font *ttf48_klickclack, *ttf52_klickclack, *ttf40_klickclack, *ttf18_burbank;
+	WorkerBatch *colliders_batch;
+	char font_files[2][8192];
+	const char *font_list[2];
+	SDL_Surface *digit_layers[20];
+	Uint64 key;
+	
+	TRACE_BEGIN ("setup");
 	
 	/* Inicializar el Video SDL */
+	TRACE_BEGIN ("setup video");
 	if (SDL_Init(SDL_INIT_VIDEO) < 0) {
 		fprintf (stderr,
 			_("Error: Can't initialize the video subsystem\n"
@@ -2333,6 +3057,23 @@ void setup (void) {
 			"%s\n"), SDL_GetError());
 		exit (1);
 	}
+	
+	TRACE_END ("setup video");
+	
+	/* Empezar a decodificar las imágenes de la presentación en los hilos
+	 * mientras el hilo principal prepara el video, el audio y las fuentes.
+	 * Las demás escenas se cargan cuando se necesiten */
+	workers_init (0);
+	scene_prefetch (SCENE_INTRO);
+	
+	/* Los colliders de los pingüinos también se leen en los hilos */
+	colliders_batch = workers_batch_start (load_collider, NULL, NUM_COLLIDERS);
+	
+	/* Generador de números aleatorios */
+	srand (benchmark_frames > 0 ? BENCHMARK_SEED : (unsigned int) getpid ());
+	
+	color_penguin = RANDOM (18);
+	
 	sprintf (buffer_file, "%simages/icon.png", systemdata_path);
 	image = IMG_Load (buffer_file);
 	if (image) {
@@ -2342,7 +3083,9 @@ void setup (void) {
 	SDL_WM_SetCaption (_("Bean Counters Classic"), _("Bean Counters Classic"));
 	
 	/* Crear la pantalla de dibujado */
+	TRACE_BEGIN ("setup video mode");
 	screen = set_video_mode (0);
+	TRACE_END ("setup video mode");
 	
 	if (screen == NULL) {
 		fprintf (stderr,
@@ -2352,6 +3095,7 @@ void setup (void) {
 		exit (1);
 	}
 	
+	TRACE_BEGIN ("setup audio");
 	use_sound = 1;
 	if (SDL_InitSubSystem (SDL_INIT_AUDIO) < 0) {
 		fprintf (stdout,
@@ -2368,47 +3112,7 @@ void setup (void) {
 			use_sound = 0;
 		}
 	}
-	
-	for (g = 0; g < NUM_IMAGES; g++) {
-		sprintf (buffer_file, "%s%s", systemdata_path, images_names[g]);
-		image = IMG_Load (buffer_file);
-		
-		if (image == NULL) {
-			fprintf (stderr,
-				_("Failed to load data file:\n"
-				"%s\n"
-				"The error returned by SDL is:\n"
-				"%s\n"), buffer_file, SDL_GetError());
-			SDL_Quit ();
-			exit (1);
-		}
-		
-		images[g] = image;
-		/* TODO: Mostrar la carga de porcentaje */
-	}
-	
-	/* Generador de números aleatorios */
-	srand ((unsigned int) getpid ());
-	
-	/* Colorear y organizar las imágenes de pingüinos */
-	color_penguin = RANDOM (18);
-	
-	setup_and_color_penguin ();
-	
-	/* Cargar los colliders de los pingüinos */
-	for (g = 0; g < NUM_COLLIDERS; g++) {
-		sprintf (buffer_file, "%s%s", systemdata_path, collider_names[g]);
-		c = collider_new_from_file (buffer_file);
-		
-		if (c == NULL) {
-			fprintf (stderr,
-				_("Failed to load data file:\n"
-				"%s\n"), buffer_file);
-			SDL_Quit ();
-			exit (1);
-		}
-		colliders[g] = c;
-	}
+	TRACE_END ("setup audio");
 	
 	/* Generar los colliders de bloque */
 	colliders_hazard_block = collider_new_block (9, 45);
@@ -2464,14 +3168,97 @@ void setup (void) {
 		exit (1);
 	}
 	
-	sprintf (buffer_file, "%s%s", systemdata_path, "klickclack.ttf");
-	ttf24_klickclack = TTF_OpenFont (buffer_file, 24);
-	ttf196_klickclack = TTF_OpenFont (buffer_file, 196);
-	ttf48_klickclack = TTF_OpenFont (buffer_file, 48);
-	ttf40_klickclack = TTF_OpenFont (buffer_file, 40);
-	ttf52_klickclack = TTF_OpenFont (buffer_file, 52);
+	bind_textdomain_codeset (PACKAGE, "UTF-8");
+	
+	/* Los textos ya renderizados salen de la caché en disco,
+	 * las fuentes sólo se abren si falta alguno */
+	sprintf (font_files[0], "%s%s", systemdata_path, "klickclack.ttf");
+	sprintf (font_files[1], "%s%s", systemdata_path, "burbanks.ttf");
+	font_list[0] = font_files[0];
+	font_list[1] = font_files[1];
+	TRACE_BEGIN ("setup texts");
+	text_cache_init (setlocale (LC_ALL, NULL), font_list, 2);
+	
+	for (g = 0; g < NUM_TEXTS; g++) {
+		key = text_cache_key (_(text_strings[g]), &text_styles[g], sizeof (TextStyle));
+		
+		if (!text_cache_get (key, &texts[g], 1)) {
+			texts[g] = render_text (g);
+			if (texts[g] != NULL) text_cache_put (key, &texts[g], 1);
+		}
+		
+		setup_progress (colliders_batch, g + 1);
+	}
+	
+	/* Los dígitos de las vidas, camiones y puntos */
+	key = text_cache_key ("0123456789", &hud_digits_style, sizeof (TextStyle));
+	if (text_cache_get (key, digit_layers, 20)) {
+		hud_digits = digit_glyphs_new_from_layers (digit_layers, hud_digits_style.outline);
+	} else {
+		hud_digits = digit_glyphs_new (get_klickclack (), hud_digits_style.size, hud_digits_style.outline, hud_digits_style.foreground, hud_digits_style.background);
+		
+		if (hud_digits != NULL) {
+			digit_glyphs_layers (hud_digits, digit_layers);
+			text_cache_put (key, digit_layers, 20);
+		}
+	}
+	
+	if (hud_digits == NULL) {
+		fprintf (stderr,
+			_("Failed to load font file 'Klick Clack\n"
+			"The error returned by SDL is:\n"
+			"%s\n"), TTF_GetError ());
+		SDL_Quit ();
+		exit (1);
+	}
+	
+	if (ttf18_burbank != NULL) {
+		TTF_CloseFont (ttf18_burbank);
+		ttf18_burbank = NULL;
+	}
+	TRACE_END ("setup texts");
+	
+	/* Mostrar el avance hasta que los hilos terminen */
+	TRACE_BEGIN ("setup wait loaders");
+	setup_progress (colliders_batch, NUM_TEXTS);
+	while ((scene_batches[SCENE_INTRO] != NULL && loader_progress (scene_batches[SCENE_INTRO]) < loader_count (scene_batches[SCENE_INTRO])) ||
+	       workers_batch_progress (colliders_batch) < NUM_COLLIDERS) {
+		SDL_Delay (10);
+		setup_progress (colliders_batch, NUM_TEXTS);
+	}
+	
+	workers_batch_wait (colliders_batch);
+	TRACE_END ("setup wait loaders");
+	
+	for (g = 0; g < NUM_COLLIDERS; g++) {
+		if (colliders[g] == NULL) {
+			sprintf (buffer_file, "%s%s", systemdata_path, collider_names[g]);
+			fprintf (stderr,
+				_("Failed to load data file:\n"
+				"%s\n"), buffer_file);
+			SDL_Quit ();
+			exit (1);
+		}
+	}
+	
+	/* Recoger las imágenes decodificadas por los hilos */
+	scene_require (SCENE_INTRO);
 	
-	if (!ttf24_klickclack || !ttf196_klickclack || !ttf48_klickclack || !ttf52_klickclack || !ttf40_klickclack) {
+	loader_report ();
+	TRACE_END ("setup");
+}
+
+/* Las fuentes se abren hasta que algún texto no está en la caché */
+SDFFont * get_klickclack (void) {
+	char buffer_file[8192];
+	
+	if (sdf_klickclack != NULL) return sdf_klickclack;
+	
+	/* Un solo atlas de distancias sirve para todos los tamaños */
+	sprintf (buffer_file, "%s%s", get_systemdata_path (), "klickclack.ttf");
+	sdf_klickclack = sdf_font_new (buffer_file);
+	
+	if (!sdf_klickclack) {
 		fprintf (stderr,
 			_("Failed to load font file 'Klick Clack\n"
 			"The error returned by SDL is:\n"
@@ -2480,7 +3267,15 @@ void setup (void) {
 		exit (1);
 	}
 	
-	sprintf (buffer_file, "%s%s", systemdata_path, "burbanks.ttf");
+	return sdf_klickclack;
+}
+
+TTF_Font * get_burbank (void) {
+	char buffer_file[8192];
+	
+	if (ttf18_burbank != NULL) return ttf18_burbank;
+	
+	sprintf (buffer_file, "%s%s", get_systemdata_path (), "burbanks.ttf");
 	ttf18_burbank = TTF_OpenFont (buffer_file, 18);
 	
 	if (!ttf18_burbank) {
@@ -2492,107 +3287,267 @@ void setup (void) {
 		exit (1);
 	}
 	
-	bind_textdomain_codeset (PACKAGE, "UTF-8");
+	return ttf18_burbank;
+}
+
+SDL_Surface * render_text (int text) {
+	const TextStyle *style = &text_styles[text];
+	SDL_Surface *surface;
+	SDL_Color color;
+	
+	TRACE_BEGIN ("text render");
+	if (style->font == FONT_BURBANK) {
+		color = style->foreground;
+		surface = draw_text (get_burbank (), _(text_strings[text]), &color);
+	} else if (style->outline > 0) {
+		surface = sdf_draw_text_with_shadow (get_klickclack (), style->size, style->outline, _(text_strings[text]), style->foreground, style->background);
+	} else {
+		surface = sdf_draw_text (get_klickclack (), style->size, _(text_strings[text]), style->foreground);
+	}
+	TRACE_END ("text render");
+	
+	return surface;
+}
+
+/* Cada cuadro es un número un poco más chico que el anterior */
+void render_countdown_frame (void *data, int item) {
+	static const char *digits[3] = {"1", "2", "3"};
+	int frame = item % COUNTDOWN_FRAMES;
+	double z;
+	
+	z = 1.0 - (COUNTDOWN_FRAMES - 1 - frame) * 0.016118421;
+	TRACE_BEGIN ("text render");
+	countdown_frames[item] = sdf_draw_text_with_shadow ((SDFFont *) data, countdown_style.size * z, countdown_style.outline * z, digits[item / COUNTDOWN_FRAMES], countdown_style.foreground, countdown_style.background);
+	TRACE_END ("text render");
+}
+
+/* Dejar los cuadros de la cuenta regresiva listos o en camino */
+void countdown_prefetch (void) {
+	Uint64 key;
 	
-	SDL_Color negro, blanco, azul1;
-	blanco.r = blanco.g = blanco.b = 255;
-	negro.r = negro.g = negro.b = 0;
-	azul1.r = 0x01;
-	azul1.g = 0x34;
-	azul1.b = 0x9a;
-	
-	for (g = TEXT_LIVES; g <= TEXT_SCORE; g++) {
-		texts[g] = draw_text_with_shadow (ttf24_klickclack, 2, _(text_strings[g]), blanco, negro);
-	}
-	
-	texts[TEXT_TRY_AGAIN] = draw_text_with_shadow (ttf48_klickclack, 2, _(text_strings[TEXT_TRY_AGAIN]), blanco, negro);
-	texts[TEXT_UNLOADED] = draw_text_with_shadow (ttf48_klickclack, 2, _(text_strings[TEXT_UNLOADED]), blanco, negro);
-	texts[TEXT_NEXT_TRUCK] = draw_text_with_shadow (ttf48_klickclack, 2, _(text_strings[TEXT_NEXT_TRUCK]), blanco, negro);
-	texts[TEXT_GAME_OVER] = draw_text_with_shadow (ttf52_klickclack, 3, _(text_strings[TEXT_GAME_OVER]), blanco, negro);
-	
-	texts[TEXT_TITLE_BEAN_COUNTERS] = draw_text (ttf40_klickclack, _(text_strings[TEXT_TITLE_BEAN_COUNTERS]), &azul1);
-	texts[TEXT_INSTRUCTIONS] = draw_text (ttf24_klickclack, _(text_strings[TEXT_INSTRUCTIONS]), &azul1);
-	texts[TEXT_PLAY_GAME] = draw_text (ttf24_klickclack, _(text_strings[TEXT_PLAY_GAME]), &azul1);
-	texts[TEXT_NEXT_PAGE] = draw_text (ttf24_klickclack, _(text_strings[TEXT_NEXT_PAGE]), &azul1);
-	texts[TEXT_CONTROLS] = draw_text (ttf40_klickclack, _(text_strings[TEXT_CONTROLS]), &azul1);
-	texts[TEXT_EXPLAIN_1] = draw_text (ttf18_burbank, _(text_strings[TEXT_EXPLAIN_1]), &azul1);
-	texts[TEXT_EXPLAIN_2] = draw_text (ttf18_burbank, _(text_strings[TEXT_EXPLAIN_2]), &azul1);
-	texts[TEXT_EXPLAIN_3] = draw_text (ttf18_burbank, _(text_strings[TEXT_EXPLAIN_3]), &azul1);
-	texts[TEXT_EXPLAIN_4] = draw_text (ttf18_burbank, _(text_strings[TEXT_EXPLAIN_4]), &azul1);
-	
-	TTF_CloseFont (ttf18_burbank);
-	TTF_CloseFont (ttf48_klickclack);
-	TTF_CloseFont (ttf52_klickclack);
-	TTF_CloseFont (ttf40_klickclack);
+	if (countdown_ready || countdown_batch != NULL) return;
+	
+	key = text_cache_key ("123", &countdown_style, sizeof (TextStyle));
+	if (text_cache_get (key, countdown_frames, 3 * COUNTDOWN_FRAMES)) {
+		countdown_ready = TRUE;
+		return;
+	}
+	
+	/* El atlas se arma aquí, los hilos sólo lo leen */
+	countdown_batch = workers_batch_start (render_countdown_frame, get_klickclack (), 3 * COUNTDOWN_FRAMES);
 }
 
-void setup_and_color_penguin (void) {
+/* Esperar a los hilos y guardar los cuadros en la caché de textos.
+ * Sólo en el hilo principal, antes de arrancar la simulación */
+void countdown_collect (void) {
+	Uint64 key;
 	int g;
-	SDL_Surface * image, *color_surface;
-	SDL_Surface *temp_penguins[NUM_PENGUIN_IMGS];
 	
+	if (countdown_batch == NULL) return;
+	
+	workers_batch_wait (countdown_batch);
+	countdown_batch = NULL;
+	countdown_ready = TRUE;
+	
+	for (g = 0; g < 3 * COUNTDOWN_FRAMES; g++) {
+		if (countdown_frames[g] == NULL) break;
+	}
+	
+	if (g == 3 * COUNTDOWN_FRAMES) {
+		key = text_cache_key ("123", &countdown_style, sizeof (TextStyle));
+		text_cache_put (key, countdown_frames, 3 * COUNTDOWN_FRAMES);
+	}
+}
+
+/* Lo llama la simulación: nunca espera, countdown_collect ya pasó */
+SDL_Surface * countdown_frame (int number, int frame) {
+	if (!countdown_ready) return NULL;
+	
+	return countdown_frames[number * COUNTDOWN_FRAMES + frame];
+}
+
+SDL_Surface * resolve_sprite (int sprite) {
+	int n = sprite & 0x0FFF;
+	
+	switch (sprite & 0xF000) {
+		case SPRITE_IMAGE (0):
+			if (n < NUM_IMAGES) return images[n];
+			break;
+		case SPRITE_TEXT (0):
+			if (n < NUM_TEXTS) return texts[n];
+			break;
+		case SPRITE_PENGUIN (0):
+			if (n < NUM_PENGUIN_FRAMES) return penguin_images[n];
+			break;
+		case SPRITE_COUNTDOWN (0, 0):
+			/* La simulación ya pasó por countdown_frame antes de anotarlo */
+			if (n < 3 * COUNTDOWN_FRAMES) return countdown_frames[n];
+			break;
+		case SPRITE_DIGIT (0):
+			return digit_glyphs_glyph (hud_digits, n);
+	}
+	
+	return NULL;
+}
+
+void add_digit_sprite (void *data, int glyph, SDL_Surface *surface, int x, int y) {
+	display_list_add ((DisplayList *) data, DRAW_HUD, SPRITE_DIGIT (glyph), x, y);
+}
+
+void load_collider (void *data, int item) {
 	char buffer_file[8192];
-	char *systemdata_path = get_systemdata_path ();
 	
+	TRACE_BEGIN ("collider load");
+	snprintf (buffer_file, sizeof (buffer_file), "%s%s", get_systemdata_path (), collider_names[item]);
+	colliders[item] = collider_new_from_file (buffer_file);
+	TRACE_END ("collider load");
+}
+
+/* El avance del arranque: imágenes de la presentación, colliders y textos */
+void setup_progress (WorkerBatch *colliders_batch, int texts_done) {
+	int done, total;
+	
+	done = workers_batch_progress (colliders_batch) + texts_done;
+	total = NUM_COLLIDERS + NUM_TEXTS;
+	
+	if (scene_batches[SCENE_INTRO] != NULL) {
+		done += loader_progress (scene_batches[SCENE_INTRO]);
+		total += loader_count (scene_batches[SCENE_INTRO]);
+	}
+	
+	loading_screen_update (done, total);
+}
+
+/* Dibuja el fondo en cuanto está listo y una barra con el avance.
+ * También atiende los eventos, para que la ventana no parezca congelada */
+void loading_screen_update (int done, int total) {
+	SDL_Event event;
+	SDL_Rect rect;
+	Uint32 now_time;
+	
+	while (present_poll_event (&event) > 0) {
+		if (event.type == SDL_QUIT) loading_quit = TRUE;
+	}
+	
+	if (screen == NULL || total <= 0) return;
+	
+	now_time = SDL_GetTicks ();
+	if (done < total && now_time < loading_last_draw + FPS) return;
+	loading_last_draw = now_time;
+	
+	if (!loading_background) {
+		if (!scene_image_ready (IMG_BACKGROUND)) return;
+		
+		SDL_BlitSurface (images[IMG_BACKGROUND], NULL, screen, NULL);
+		present_flip ();
+		loading_background = TRUE;
+	}
+	
+	/* El marco, el fondo y el avance */
+	rect.x = 228; rect.y = 438;
+	rect.w = 304; rect.h = 20;
+	SDL_FillRect (screen, &rect, SDL_MapRGB (screen->format, 255, 255, 255));
+	
+	rect.x = 230; rect.y = 440;
+	rect.w = 300; rect.h = 16;
+	SDL_FillRect (screen, &rect, SDL_MapRGB (screen->format, 0x01, 0x34, 0x9a));
+	
+	rect.w = (300 * done) / total;
+	SDL_FillRect (screen, &rect, SDL_MapRGB (screen->format, 255, 255, 0));
+	
+	present_update_rect (228, 438, 304, 20);
+}
+
+void setup_and_color_penguin (SDL_Surface **temp_penguins) {
+	SDL_Surface *copies[NUM_PENGUIN_IMGS], *white_frames[NUM_PENGUIN_FRAMES];
+	SDL_Color black = {0, 0, 0}, white = {255, 255, 255};
+	int g;
+	
+	/* Armar los cuadros dos veces, con negro y con blanco, para sacar
+	 * cuánto color recibe cada pixel. Con eso cambiar de color es una
+	 * sola pasada por cuadro, sin volver a mezclar las capas */
 	for (g = 0; g < NUM_PENGUIN_IMGS; g++) {
-		sprintf (buffer_file, "%s%s", systemdata_path, penguin_images_names[g]);
-		image = IMG_Load (buffer_file);
+		copies[g] = SDL_ConvertSurface (temp_penguins[g], temp_penguins[g]->format, temp_penguins[g]->flags & SDL_SRCALPHA);
+	}
+	
+	compose_penguin_frames (temp_penguins, black, penguin_base);
+	compose_penguin_frames (copies, white, white_frames);
+	
+	for (g = 0; g < NUM_PENGUIN_FRAMES; g++) {
+		penguin_weight[g] = tint_weight_new (penguin_base[g], white_frames[g]);
+		SDL_FreeSurface (white_frames[g]);
 		
-		if (image == NULL) {
+		if (penguin_weight[g] == NULL) {
 			fprintf (stderr,
-				_("Failed to load data file:\n"
-				"%s\n"
-				"The error returned by SDL is:\n"
-				"%s\n"), buffer_file, SDL_GetError());
+				_("Failed to create the penguin images\n"));
 			SDL_Quit ();
 			exit (1);
 		}
+	}
+}
+
+void set_penguin_color (int color) {
+	int g;
+	SDL_PixelFormat *fmt;
+	
+	for (g = 0; g < NUM_PENGUIN_FRAMES; g++) {
+		if (penguin_images[g] == NULL) {
+			fmt = penguin_base[g]->format;
+			penguin_images[g] = SDL_CreateRGBSurface (SDL_SWSURFACE | SDL_SRCALPHA, penguin_base[g]->w, penguin_base[g]->h, 32, fmt->Rmask, fmt->Gmask, fmt->Bmask, fmt->Amask);
+		}
 		
-		temp_penguins[g] = image;
-		/* TODO: Mostrar la carga de porcentaje */
+		sprite_cache_forget (penguin_images[g]);
+		tint_apply (penguin_base[g], penguin_weight[g], penguin_images[g], penguin_colors[color]);
 	}
 	
+	color_penguin = color;
+}
+
+void compose_penguin_frames (SDL_Surface **temp_penguins, SDL_Color color, SDL_Surface **frames) {
+	int g;
+	SDL_Surface *color_surface;
+	
 	color_surface = SDL_CreateRGBSurface (SDL_SWSURFACE, 196, 199, 32, RMASK, GMASK, BMASK, AMASK);
-	SDL_FillRect (color_surface, NULL, SDL_MapRGB (color_surface->format, penguin_colors[color_penguin].r, penguin_colors[color_penguin].g, penguin_colors[color_penguin].b));
+	SDL_FillRect (color_surface, NULL, SDL_MapRGB (color_surface->format, color.r, color.g, color.b));
 	
 	for (g = 0; g < 4; g++) {
-		penguin_images[PENGUIN_FRAME_1 + g] = temp_penguins[IMG_PENGUIN_1_BACK + (g * 3)];
+		frames[PENGUIN_FRAME_1 + g] = temp_penguins[IMG_PENGUIN_1_BACK + (g * 3)];
 		
 		/* Colorear el pingüino */
 		SDL_BlitSurface (color_surface, NULL, temp_penguins[IMG_PENGUIN_1_COLOR + (g * 3)], NULL);
 		
 		/* Copiar el color sobre el fondo */
-		SDL_gfxBlitRGBA (temp_penguins[IMG_PENGUIN_1_COLOR + (g * 3)], NULL, penguin_images[PENGUIN_FRAME_1 + g], NULL);
+		SDL_gfxBlitRGBA (temp_penguins[IMG_PENGUIN_1_COLOR + (g * 3)], NULL, frames[PENGUIN_FRAME_1 + g], NULL);
 		SDL_FreeSurface (temp_penguins[IMG_PENGUIN_1_COLOR + (g * 3)]);
 		temp_penguins[IMG_PENGUIN_1_COLOR + (g * 3)] = NULL;
 		
 		/* Copiar el frente */
-		SDL_gfxBlitRGBA (temp_penguins[IMG_PENGUIN_1_FRONT + (g * 3)], NULL, penguin_images[PENGUIN_FRAME_1 + g], NULL);
+		SDL_gfxBlitRGBA (temp_penguins[IMG_PENGUIN_1_FRONT + (g * 3)], NULL, frames[PENGUIN_FRAME_1 + g], NULL);
 		SDL_FreeSurface (temp_penguins[IMG_PENGUIN_1_FRONT + (g * 3)]);
 		temp_penguins[IMG_PENGUIN_1_FRONT + (g * 3)] = NULL;
 	}
 	
 	/* Duplicar el fondo del frame 5 */
-	penguin_images[PENGUIN_FRAME_5_1] = temp_penguins[IMG_PENGUIN_5_BACK];
-	penguin_images[PENGUIN_FRAME_5_2] = SDL_CreateRGBSurface (SDL_SWSURFACE, 196, 199, 32, RMASK, GMASK, BMASK, AMASK);
-	penguin_images[PENGUIN_FRAME_5_3] = SDL_CreateRGBSurface (SDL_SWSURFACE, 196, 199, 32, RMASK, GMASK, BMASK, AMASK);
+	frames[PENGUIN_FRAME_5_1] = temp_penguins[IMG_PENGUIN_5_BACK];
+	frames[PENGUIN_FRAME_5_2] = SDL_CreateRGBSurface (SDL_SWSURFACE, 196, 199, 32, RMASK, GMASK, BMASK, AMASK);
+	frames[PENGUIN_FRAME_5_3] = SDL_CreateRGBSurface (SDL_SWSURFACE, 196, 199, 32, RMASK, GMASK, BMASK, AMASK);
 	
-	SDL_SetAlpha (penguin_images[PENGUIN_FRAME_5_1], 0, 0);
-	SDL_BlitSurface (penguin_images[PENGUIN_FRAME_5_1], NULL, penguin_images[PENGUIN_FRAME_5_2], NULL);
-	SDL_BlitSurface (penguin_images[PENGUIN_FRAME_5_1], NULL, penguin_images[PENGUIN_FRAME_5_3], NULL);
-	SDL_SetAlpha (penguin_images[PENGUIN_FRAME_5_1], SDL_SRCALPHA, SDL_ALPHA_OPAQUE);
+	SDL_SetAlpha (frames[PENGUIN_FRAME_5_1], 0, 0);
+	SDL_BlitSurface (frames[PENGUIN_FRAME_5_1], NULL, frames[PENGUIN_FRAME_5_2], NULL);
+	SDL_BlitSurface (frames[PENGUIN_FRAME_5_1], NULL, frames[PENGUIN_FRAME_5_3], NULL);
+	SDL_SetAlpha (frames[PENGUIN_FRAME_5_1], SDL_SRCALPHA, SDL_ALPHA_OPAQUE);
 	
 	/* Colorear el pingüino */
 	SDL_BlitSurface (color_surface, NULL, temp_penguins[IMG_PENGUIN_5_COLOR], NULL);
-	SDL_gfxBlitRGBA (temp_penguins[IMG_PENGUIN_5_COLOR], NULL, penguin_images[PENGUIN_FRAME_5_1], NULL);
-	SDL_gfxBlitRGBA (temp_penguins[IMG_PENGUIN_5_COLOR], NULL, penguin_images[PENGUIN_FRAME_5_2], NULL);
-	SDL_gfxBlitRGBA (temp_penguins[IMG_PENGUIN_5_COLOR], NULL, penguin_images[PENGUIN_FRAME_5_3], NULL);
+	SDL_gfxBlitRGBA (temp_penguins[IMG_PENGUIN_5_COLOR], NULL, frames[PENGUIN_FRAME_5_1], NULL);
+	SDL_gfxBlitRGBA (temp_penguins[IMG_PENGUIN_5_COLOR], NULL, frames[PENGUIN_FRAME_5_2], NULL);
+	SDL_gfxBlitRGBA (temp_penguins[IMG_PENGUIN_5_COLOR], NULL, frames[PENGUIN_FRAME_5_3], NULL);
 	SDL_FreeSurface (temp_penguins[IMG_PENGUIN_5_COLOR]);
 	temp_penguins[IMG_PENGUIN_5_COLOR] = NULL;
 	
-	SDL_gfxBlitRGBA (temp_penguins[IMG_PENGUIN_5_1_FRONT], NULL, penguin_images[PENGUIN_FRAME_5_1], NULL);
-	SDL_gfxBlitRGBA (temp_penguins[IMG_PENGUIN_5_2_FRONT], NULL, penguin_images[PENGUIN_FRAME_5_2], NULL);
-	SDL_gfxBlitRGBA (temp_penguins[IMG_PENGUIN_5_3_FRONT], NULL, penguin_images[PENGUIN_FRAME_5_3], NULL);
+	SDL_gfxBlitRGBA (temp_penguins[IMG_PENGUIN_5_1_FRONT], NULL, frames[PENGUIN_FRAME_5_1], NULL);
+	SDL_gfxBlitRGBA (temp_penguins[IMG_PENGUIN_5_2_FRONT], NULL, frames[PENGUIN_FRAME_5_2], NULL);
+	SDL_gfxBlitRGBA (temp_penguins[IMG_PENGUIN_5_3_FRONT], NULL, frames[PENGUIN_FRAME_5_3], NULL);
 	
 	SDL_FreeSurface (temp_penguins[IMG_PENGUIN_5_1_FRONT]);
 	SDL_FreeSurface (temp_penguins[IMG_PENGUIN_5_2_FRONT]);
@@ -2609,14 +3564,14 @@ void setup_and_color_penguin (void) {
 	
 	/* 6 frames de animación del frame 6 */
 	for (g = 0; g < 6; g++) {
-		penguin_images[PENGUIN_FRAME_6_1 + g] = SDL_CreateRGBSurface (SDL_SWSURFACE, 196, 199, 32, RMASK, GMASK, BMASK, AMASK);
+		frames[PENGUIN_FRAME_6_1 + g] = SDL_CreateRGBSurface (SDL_SWSURFACE, 196, 199, 32, RMASK, GMASK, BMASK, AMASK);
 		
 		/* Clonar el fondo */
-		SDL_BlitSurface (temp_penguins[IMG_PENGUIN_6_1_BACK + (g % 2)], NULL, penguin_images[PENGUIN_FRAME_6_1 + g], NULL);
+		SDL_BlitSurface (temp_penguins[IMG_PENGUIN_6_1_BACK + (g % 2)], NULL, frames[PENGUIN_FRAME_6_1 + g], NULL);
 		
-		SDL_gfxBlitRGBA (temp_penguins[IMG_PENGUIN_6_1_COLOR + (g % 2)], NULL, penguin_images[PENGUIN_FRAME_6_1 + g], NULL);
+		SDL_gfxBlitRGBA (temp_penguins[IMG_PENGUIN_6_1_COLOR + (g % 2)], NULL, frames[PENGUIN_FRAME_6_1 + g], NULL);
 		
-		SDL_gfxBlitRGBA (temp_penguins[IMG_PENGUIN_6_1_FRONT + g], NULL, penguin_images[PENGUIN_FRAME_6_1 + g], NULL);
+		SDL_gfxBlitRGBA (temp_penguins[IMG_PENGUIN_6_1_FRONT + g], NULL, frames[PENGUIN_FRAME_6_1 + g], NULL);
 		
 		SDL_FreeSurface (temp_penguins[IMG_PENGUIN_6_1_FRONT + g]);
 		temp_penguins[IMG_PENGUIN_6_1_FRONT + g] = NULL;
@@ -2631,48 +3586,283 @@ void setup_and_color_penguin (void) {
 	temp_penguins[IMG_PENGUIN_6_1_COLOR] = temp_penguins[IMG_PENGUIN_6_2_COLOR] = NULL;
 	
 	/* Armar el frame 7 */
-	penguin_images[PENGUIN_FRAME_7] = temp_penguins[IMG_PENGUIN_7_BACK];
+	frames[PENGUIN_FRAME_7] = temp_penguins[IMG_PENGUIN_7_BACK];
 	
 	/* Colorear el pingüino */
 	SDL_BlitSurface (color_surface, NULL, temp_penguins[IMG_PENGUIN_7_COLOR], NULL);
 	
 	/* Copiar el color sobre el fondo */
-	SDL_gfxBlitRGBA (temp_penguins[IMG_PENGUIN_7_COLOR], NULL, penguin_images[PENGUIN_FRAME_7], NULL);
+	SDL_gfxBlitRGBA (temp_penguins[IMG_PENGUIN_7_COLOR], NULL, frames[PENGUIN_FRAME_7], NULL);
 	SDL_FreeSurface (temp_penguins[IMG_PENGUIN_7_COLOR]);
 	temp_penguins[IMG_PENGUIN_7_COLOR] = NULL;
 	
 	/* Copiar el frente */
-	SDL_gfxBlitRGBA (temp_penguins[IMG_PENGUIN_7_FRONT], NULL, penguin_images[PENGUIN_FRAME_7], NULL);
+	SDL_gfxBlitRGBA (temp_penguins[IMG_PENGUIN_7_FRONT], NULL, frames[PENGUIN_FRAME_7], NULL);
 	SDL_FreeSurface (temp_penguins[IMG_PENGUIN_7_FRONT]);
 	temp_penguins[IMG_PENGUIN_7_FRONT] = NULL;
 	
 	/* Generar los otros 3 estados */
-	penguin_images[PENGUIN_FRAME_8] = temp_penguins[IMG_PENGUIN_8_BACK];
-	penguin_images[PENGUIN_FRAME_9] = SDL_CreateRGBSurface (SDL_SWSURFACE, 196, 199, 32, RMASK, GMASK, BMASK, AMASK);
-	penguin_images[PENGUIN_FRAME_10] = SDL_CreateRGBSurface (SDL_SWSURFACE, 196, 199, 32, RMASK, GMASK, BMASK, AMASK);
+	frames[PENGUIN_FRAME_8] = temp_penguins[IMG_PENGUIN_8_BACK];
+	frames[PENGUIN_FRAME_9] = SDL_CreateRGBSurface (SDL_SWSURFACE, 196, 199, 32, RMASK, GMASK, BMASK, AMASK);
+	frames[PENGUIN_FRAME_10] = SDL_CreateRGBSurface (SDL_SWSURFACE, 196, 199, 32, RMASK, GMASK, BMASK, AMASK);
 	
-	SDL_SetAlpha (penguin_images[PENGUIN_FRAME_8], 0, 0);
-	SDL_BlitSurface (penguin_images[PENGUIN_FRAME_8], NULL, penguin_images[PENGUIN_FRAME_9], NULL);
-	SDL_BlitSurface (penguin_images[PENGUIN_FRAME_8], NULL, penguin_images[PENGUIN_FRAME_10], NULL);
-	SDL_SetAlpha (penguin_images[PENGUIN_FRAME_8], SDL_SRCALPHA, SDL_ALPHA_OPAQUE);
+	SDL_SetAlpha (frames[PENGUIN_FRAME_8], 0, 0);
+	SDL_BlitSurface (frames[PENGUIN_FRAME_8], NULL, frames[PENGUIN_FRAME_9], NULL);
+	SDL_BlitSurface (frames[PENGUIN_FRAME_8], NULL, frames[PENGUIN_FRAME_10], NULL);
+	SDL_SetAlpha (frames[PENGUIN_FRAME_8], SDL_SRCALPHA, SDL_ALPHA_OPAQUE);
 	
 	/* Colorear el pingüino */
 	SDL_BlitSurface (color_surface, NULL, temp_penguins[IMG_PENGUIN_8_COLOR], NULL);
-	SDL_gfxBlitRGBA (temp_penguins[IMG_PENGUIN_8_COLOR], NULL, penguin_images[PENGUIN_FRAME_8], NULL);
-	SDL_gfxBlitRGBA (temp_penguins[IMG_PENGUIN_8_COLOR], NULL, penguin_images[PENGUIN_FRAME_9], NULL);
-	SDL_gfxBlitRGBA (temp_penguins[IMG_PENGUIN_8_COLOR], NULL, penguin_images[PENGUIN_FRAME_10], NULL);
+	SDL_gfxBlitRGBA (temp_penguins[IMG_PENGUIN_8_COLOR], NULL, frames[PENGUIN_FRAME_8], NULL);
+	SDL_gfxBlitRGBA (temp_penguins[IMG_PENGUIN_8_COLOR], NULL, frames[PENGUIN_FRAME_9], NULL);
+	SDL_gfxBlitRGBA (temp_penguins[IMG_PENGUIN_8_COLOR], NULL, frames[PENGUIN_FRAME_10], NULL);
 	SDL_FreeSurface (temp_penguins[IMG_PENGUIN_8_COLOR]);
 	temp_penguins[IMG_PENGUIN_8_COLOR] = NULL;
 	
-	SDL_gfxBlitRGBA (temp_penguins[IMG_PENGUIN_8_1_FRONT], NULL, penguin_images[PENGUIN_FRAME_8], NULL);
-	SDL_gfxBlitRGBA (temp_penguins[IMG_PENGUIN_8_2_FRONT], NULL, penguin_images[PENGUIN_FRAME_9], NULL);
-	SDL_gfxBlitRGBA (temp_penguins[IMG_PENGUIN_8_3_FRONT], NULL, penguin_images[PENGUIN_FRAME_10], NULL);
+	SDL_gfxBlitRGBA (temp_penguins[IMG_PENGUIN_8_1_FRONT], NULL, frames[PENGUIN_FRAME_8], NULL);
+	SDL_gfxBlitRGBA (temp_penguins[IMG_PENGUIN_8_2_FRONT], NULL, frames[PENGUIN_FRAME_9], NULL);
+	SDL_gfxBlitRGBA (temp_penguins[IMG_PENGUIN_8_3_FRONT], NULL, frames[PENGUIN_FRAME_10], NULL);
 	
 	SDL_FreeSurface (temp_penguins[IMG_PENGUIN_8_1_FRONT]);
 	SDL_FreeSurface (temp_penguins[IMG_PENGUIN_8_2_FRONT]);
 	SDL_FreeSurface (temp_penguins[IMG_PENGUIN_8_3_FRONT]);
 	
 	temp_penguins[IMG_PENGUIN_8_1_FRONT] = temp_penguins[IMG_PENGUIN_8_2_FRONT] = temp_penguins[IMG_PENGUIN_8_3_FRONT] = NULL;
+
+	SDL_FreeSurface (color_surface);
+}
+
+int load_penguin_cache (void) {
+	char buffer_file[8192];
+	char *systemdata_path = get_systemdata_path ();
+	char *cache_path = get_cache_path ();
+	SDL_Surface *layers[NUM_PENGUIN_FRAMES * 2];
+	int g;
+	
+	if (cache_path == NULL) return FALSE;
+	
+	/* La llave depende sólo de los archivos originales,
+	 * las capas sirven para cualquier color */
+	penguin_cache_key = SURFACE_CACHE_HASH_INIT;
+	for (g = 0; g < NUM_PENGUIN_IMGS; g++) {
+		sprintf (buffer_file, "%s%s", systemdata_path, penguin_images_names[g]);
+		if (surface_cache_hash_file (&penguin_cache_key, buffer_file) < 0) return FALSE;
+	}
+	
+	sprintf (buffer_file, "%spenguin_tint.cache", cache_path);
+	penguin_cache = surface_cache_load (buffer_file, penguin_cache_key, layers, NUM_PENGUIN_FRAMES * 2);
+	
+	if (penguin_cache == NULL) return FALSE;
+	
+	for (g = 0; g < NUM_PENGUIN_FRAMES; g++) {
+		penguin_base[g] = layers[g];
+		penguin_weight[g] = layers[NUM_PENGUIN_FRAMES + g];
+	}
+	
+	return TRUE;
+}
+
+void save_penguin_cache (void) {
+	char buffer_file[8192];
+	char *cache_path = get_cache_path ();
+	SDL_Surface *layers[NUM_PENGUIN_FRAMES * 2];
+	int g;
+	
+	if (cache_path == NULL) return;
+	
+	if (!folder_create (cache_path)) return;
+	
+	for (g = 0; g < NUM_PENGUIN_FRAMES; g++) {
+		layers[g] = penguin_base[g];
+		layers[NUM_PENGUIN_FRAMES + g] = penguin_weight[g];
+	}
+	
+	sprintf (buffer_file, "%spenguin_tint.cache", cache_path);
+	if (surface_cache_save (buffer_file, penguin_cache_key, layers, NUM_PENGUIN_FRAMES * 2) < 0) {
+		fprintf (stderr, "Warning: Can't write the penguin cache file %s\n", buffer_file);
+	}
+}
+
+void scene_prefetch (int scene) {
+	int items[NUM_IMAGES];
+	int g, n;
+	const ImageRange *r;
+	char *systemdata_path = get_systemdata_path ();
+	
+	/* Ya hay un lote en camino, scene_require completa lo que falte */
+	if (scene_batches[scene] != NULL) return;
+	
+	/* Sólo las imágenes que no están cargadas ni en camino */
+	n = 0;
+	for (r = scene_manifests[scene].ranges; r->first >= 0; r++) {
+		for (g = r->first; g <= r->last; g++) {
+			if (images[g] == NULL && !image_pending[g]) {
+				image_pending[g] = TRUE;
+				items[n++] = g;
+			}
+		}
+	}
+	
+	if (n > 0) {
+		scene_batches[scene] = loader_start_items (systemdata_path, images_names, images, items, n);
+	}
+	
+	/* Si las capas de los pingüinos ya están en la caché, no hace falta decodificarlos */
+	if (scene_manifests[scene].penguins && !penguins_ready && penguins_batch == NULL) {
+		if (load_penguin_cache ()) {
+			penguins_ready = TRUE;
+		} else {
+			penguins_batch = loader_start (systemdata_path, penguin_images_names, temp_penguins, NUM_PENGUIN_IMGS);
+		}
+	}
+}
+
+/* Recoger todos los lotes pendientes, aunque sean de otra escena,
+ * así las banderas de pendiente siempre quedan al día */
+int scene_collect (char *failed_file, int size) {
+	int g, failed;
+	
+	failed = FALSE;
+	for (g = 0; g < NUM_SCENES; g++) {
+		if (scene_batches[g] == NULL) continue;
+		
+		if (loader_wait (scene_batches[g], failed_file, size) < 0) failed = TRUE;
+		scene_batches[g] = NULL;
+	}
+	
+	memset (image_pending, 0, sizeof (image_pending));
+	
+	return failed;
+}
+
+/* Revisa si una imagen ya se puede usar, aunque su lote siga en camino */
+int scene_image_ready (int image) {
+	int g;
+	
+	if (!image_pending[image]) return (images[image] != NULL);
+	
+	for (g = 0; g < NUM_SCENES; g++) {
+		if (scene_batches[g] != NULL && loader_slot_ready (scene_batches[g], image)) return TRUE;
+	}
+	
+	return FALSE;
+}
+
+void scene_require (int scene) {
+	char buffer_file[8192], penguin_file[8192], error[512];
+	int failed, done, total, g;
+	
+	/* Con poca memoria, soltar primero lo que la escena no usa */
+	if (low_memory) scene_release (scene);
+	
+	/* Dos vueltas: la primera recoge lo que ya venía en camino,
+	 * la segunda carga lo que aún falte */
+	scene_prefetch (scene);
+	
+	/* Mientras los hilos terminan, mostrar el avance */
+	TRACE_BEGIN ("scene load wait");
+	do {
+		done = total = 0;
+		for (g = 0; g < NUM_SCENES; g++) {
+			if (scene_batches[g] == NULL) continue;
+			done += loader_progress (scene_batches[g]);
+			total += loader_count (scene_batches[g]);
+		}
+		
+		if (penguins_batch != NULL && scene_manifests[scene].penguins) {
+			done += loader_progress (penguins_batch);
+			total += NUM_PENGUIN_IMGS;
+		}
+		
+		if (done < total) {
+			loading_screen_update (done, total);
+			SDL_Delay (10);
+		}
+	} while (done < total);
+	TRACE_END ("scene load wait");
+	
+	failed = scene_collect (buffer_file, sizeof (buffer_file));
+	
+	if (!failed) {
+		scene_prefetch (scene);
+		failed = scene_collect (buffer_file, sizeof (buffer_file));
+	}
+	
+	if (failed) snprintf (error, sizeof (error), "%s", loader_get_error ());
+	
+	/* Aunque algo más haya fallado, hay que esperar a los pingüinos:
+	 * sus hilos todavía escriben en temp_penguins */
+	if (penguins_batch != NULL && (failed || scene_manifests[scene].penguins)) {
+		if (loader_wait (penguins_batch, penguin_file, sizeof (penguin_file)) < 0 && !failed) {
+			strcpy (buffer_file, penguin_file);
+			snprintf (error, sizeof (error), "%s", loader_get_error ());
+			failed = TRUE;
+		}
+		penguins_batch = NULL;
+		
+		if (!failed) {
+			setup_and_color_penguin (temp_penguins);
+			save_penguin_cache ();
+			penguins_ready = TRUE;
+		}
+	}
+	
+	if (failed) {
+		fprintf (stderr,
+			_("Failed to load data file:\n"
+			"%s\n"
+			"The error returned by SDL is:\n"
+			"%s\n"), buffer_file, error);
+		SDL_Quit ();
+		exit (1);
+	}
+	
+	if (scene_manifests[scene].penguins && penguin_images[0] == NULL) {
+		set_penguin_color (color_penguin);
+	}
+	
+	/* Cerraron la ventana mientras se cargaba */
+	if (loading_quit) {
+		workers_shutdown ();
+#ifdef ENABLE_PERF_COUNTERS
+		perf_counters_close ();
+#endif
+		watchdog_close ();
+		trace_close ();
+		SDL_Quit ();
+		exit (EXIT_SUCCESS);
+	}
+}
+
+/* Liberar las imágenes que la escena no necesita */
+void scene_release (int scene) {
+	int used[NUM_IMAGES];
+	const ImageRange *r;
+	int g;
+	
+	memset (used, 0, sizeof (used));
+	for (r = scene_manifests[scene].ranges; r->first >= 0; r++) {
+		for (g = r->first; g <= r->last; g++) {
+			used[g] = TRUE;
+		}
+	}
+	
+	for (g = 0; g < NUM_IMAGES; g++) {
+		if (used[g] || image_pending[g] || images[g] == NULL) continue;
+		
+		sprite_cache_forget (images[g]);
+		SDL_FreeSurface (images[g]);
+		images[g] = NULL;
+	}
+	
+	/* Los cuadros coloreados se vuelven a generar desde las capas */
+	if (!scene_manifests[scene].penguins && penguin_images[0] != NULL) {
+		for (g = 0; g < NUM_PENGUIN_FRAMES; g++) {
+			sprite_cache_forget (penguin_images[g]);
+			SDL_FreeSurface (penguin_images[g]);
+			penguin_images[g] = NULL;
+		}
+	}
 }
 
 void add_bag (int tipo) {
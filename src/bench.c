@@ -0,0 +1,387 @@
+/*
+ * bench.c
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Pruebas de velocidad de las funciones que más trabajan en cada cuadro:
+ * colisiones, blits, zoom y texto, con los archivos reales del juego.
+ *
+ * Cada caso se calienta, luego se calcula cuántas llamadas caben en
+ * BENCH_TARGET_US y se repite esa tanda varias veces. Se reporta la mediana
+ * por operación, y con --csv la salida se puede comparar entre versiones
+ * y máquinas.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <SDL.h>
+#include <SDL_image.h>
+#include <SDL_ttf.h>
+
+#include "path.h"
+#include "collider.h"
+#include "gfx_blit_func.h"
+#include "zoom.h"
+#include "draw-text.h"
+#include "sdf-text.h"
+#include "workers.h"
+#include "timing.h"
+
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+#define RMASK 0xff000000
+#define GMASK 0x00ff0000
+#define BMASK 0x0000ff00
+#define AMASK 0x000000ff
+#else
+#define RMASK 0x000000ff
+#define GMASK 0x0000ff00
+#define BMASK 0x00ff0000
+#define AMASK 0xff000000
+#endif
+
+/* Tiempo que debe durar cada repetición */
+#define BENCH_TARGET_US 5000
+
+#define BENCH_MAX_REPS 1000
+
+typedef void (*BenchFunc) (void *data);
+
+typedef struct {
+	Collider *object;
+	Collider *penguins[10];
+} BenchCollide;
+
+typedef struct {
+	SDL_Surface *sprite, *screen;
+	int alpha;
+} BenchBlit;
+
+typedef struct {
+	SDL_Surface *sprite;
+	double scale;
+	int smooth;
+} BenchZoom;
+
+typedef struct {
+	TTF_Font *font;
+	SDFFont *sdf;
+	const char *text;
+} BenchText;
+
+static const char *bench_penguin_colliders[10] = {
+	"collider/penguin_1.col",
+	"collider/penguin_2.col",
+	"collider/penguin_3.col",
+	"collider/penguin_4.col",
+	"collider/penguin_5.col",
+	"collider/penguin_6.col",
+	"collider/penguin_7.col",
+	"collider/penguin_8.col",
+	"collider/penguin_9.col",
+	"collider/penguin_10.col"
+};
+
+/* Los sprites que más se dibujan en el juego */
+static const char *bench_sprites[] = {
+	"images/bag_3.png",
+	"images/oneup.png",
+	"images/fish.png",
+	"images/anvil_12.png",
+	"images/penguin_1_front.png",
+	"images/truck.png",
+	"images/background.png"
+};
+
+#define NUM_BENCH_SPRITES (sizeof (bench_sprites) / sizeof (bench_sprites[0]))
+
+/* Los textos del HUD */
+static const char *bench_hud_strings[] = {
+	"LIVES:",
+	"TRUCK:",
+	"SCORE:",
+	"1234567"
+};
+
+#define NUM_BENCH_HUD_STRINGS (sizeof (bench_hud_strings) / sizeof (bench_hud_strings[0]))
+
+/* Rango de posiciones de los objetos contra el pingüino en 120, 251 */
+#define BENCH_COLLIDE_X0 60
+#define BENCH_COLLIDE_X1 420
+#define BENCH_COLLIDE_Y0 120
+#define BENCH_COLLIDE_Y1 420
+#define BENCH_COLLIDE_STEP 12
+#define BENCH_COLLIDE_OPS (10 * ((BENCH_COLLIDE_X1 - BENCH_COLLIDE_X0) / BENCH_COLLIDE_STEP) * ((BENCH_COLLIDE_Y1 - BENCH_COLLIDE_Y0) / BENCH_COLLIDE_STEP))
+
+static int bench_warmup = 20;
+static int bench_reps = 31;
+static int bench_csv = 0;
+static const char *bench_filter = NULL;
+static const char *bench_data = NULL;
+
+/* Para que el compilador no quite las llamadas */
+static volatile int bench_sink;
+
+static int bench_compare (const void *a, const void *b) {
+	double da = *(const double *) a, db = *(const double *) b;
+	
+	return (da > db) - (da < db);
+}
+
+/* ops es cuántas operaciones hace cada llamada a func */
+static void bench_run (const char *kernel, const char *name, BenchFunc func, void *data, int ops) {
+	double samples[BENCH_MAX_REPS];
+	Uint64 start, elapsed;
+	int inner, g, h;
+	
+	if (bench_filter != NULL && strstr (kernel, bench_filter) == NULL && strstr (name, bench_filter) == NULL) return;
+	
+	for (g = 0; g < bench_warmup; g++) {
+		func (data);
+	}
+	
+	/* Calcular cuántas llamadas llenan una repetición */
+	start = timing_now_us ();
+	func (data);
+	elapsed = timing_now_us () - start;
+	inner = (elapsed == 0) ? BENCH_TARGET_US : (int) (BENCH_TARGET_US / elapsed);
+	if (inner < 1) inner = 1;
+	
+	for (g = 0; g < bench_reps; g++) {
+		start = timing_now_us ();
+		for (h = 0; h < inner; h++) {
+			func (data);
+		}
+		elapsed = timing_now_us () - start;
+		
+		samples[g] = (elapsed * 1000.0) / ((double) inner * ops);
+	}
+	
+	qsort (samples, bench_reps, sizeof (double), bench_compare);
+	
+	if (bench_csv) {
+		printf ("%s,%s,%i,%i,%i,%.3f,%.3f,%.3f\n", kernel, name, ops, inner, bench_reps, samples[bench_reps / 2], samples[0], samples[bench_reps - 1]);
+	} else {
+		printf ("%-10s %-36s %12.1f %12.1f %12.1f\n", kernel, name, samples[bench_reps / 2], samples[0], samples[bench_reps - 1]);
+	}
+}
+
+static void bench_collide (void *data) {
+	BenchCollide *b = (BenchCollide *) data;
+	int p, x, y, hits = 0;
+	
+	for (p = 0; p < 10; p++) {
+		for (y = BENCH_COLLIDE_Y0; y + BENCH_COLLIDE_STEP <= BENCH_COLLIDE_Y1; y += BENCH_COLLIDE_STEP) {
+			for (x = BENCH_COLLIDE_X0; x + BENCH_COLLIDE_STEP <= BENCH_COLLIDE_X1; x += BENCH_COLLIDE_STEP) {
+				hits += collider_hittest (b->object, x, y, b->penguins[p], 120, 251);
+			}
+		}
+	}
+	
+	bench_sink = hits;
+}
+
+static void bench_blit (void *data) {
+	BenchBlit *b = (BenchBlit *) data;
+	SDL_Rect rect;
+	
+	rect.x = 0;
+	rect.y = 0;
+	rect.w = b->sprite->w;
+	rect.h = b->sprite->h;
+	
+	if (b->alpha < 0) {
+		SDL_gfxBlitRGBA (b->sprite, NULL, b->screen, &rect);
+	} else {
+		SDL_gfxBlitRGBAWithAlpha (b->sprite, NULL, b->screen, &rect, b->alpha);
+	}
+}
+
+static void bench_zoom (void *data) {
+	BenchZoom *b = (BenchZoom *) data;
+	SDL_Surface *scaled;
+	
+	scaled = zoomSurface (b->sprite, b->scale, b->scale, b->smooth);
+	if (scaled != NULL) SDL_FreeSurface (scaled);
+}
+
+static void bench_text_ttf (void *data) {
+	BenchText *b = (BenchText *) data;
+	SDL_Color white = {255, 255, 255, 0}, black = {0, 0, 0, 0};
+	SDL_Surface *text;
+	
+	text = draw_text_with_shadow (b->font, 2, b->text, white, black);
+	if (text != NULL) SDL_FreeSurface (text);
+}
+
+static void bench_text_sdf (void *data) {
+	BenchText *b = (BenchText *) data;
+	SDL_Color white = {255, 255, 255, 0}, black = {0, 0, 0, 0};
+	SDL_Surface *text;
+	
+	text = sdf_draw_text_with_shadow (b->sdf, 24, 2, b->text, white, black);
+	if (text != NULL) SDL_FreeSurface (text);
+}
+
+static SDL_Surface * bench_load_image (const char *name) {
+	char buffer_file[8192];
+	SDL_Surface *image;
+	
+	snprintf (buffer_file, sizeof (buffer_file), "%s%s", bench_data, name);
+	image = IMG_Load (buffer_file);
+	
+	if (image == NULL) {
+		fprintf (stderr, "Failed to load data file:\n%s\n", buffer_file);
+		exit (1);
+	}
+	
+	return image;
+}
+
+static Collider * bench_load_collider (const char *name) {
+	char buffer_file[8192];
+	Collider *c;
+	
+	snprintf (buffer_file, sizeof (buffer_file), "%s%s", bench_data, name);
+	c = collider_new_from_file (buffer_file);
+	
+	if (c == NULL) {
+		fprintf (stderr, "Failed to load data file:\n%s\n", buffer_file);
+		exit (1);
+	}
+	
+	return c;
+}
+
+static void bench_usage (const char *argv_0) {
+	printf ("Usage: %s [--csv] [--reps N] [--warmup N] [--filter TEXT] [--data DIR]\n", argv_0);
+}
+
+int main (int argc, char *argv[]) {
+	BenchCollide collide;
+	BenchBlit blit;
+	BenchZoom zoom;
+	BenchText text;
+	SDL_Surface *sprites[NUM_BENCH_SPRITES];
+	char name[64], buffer_file[8192];
+	int g;
+	
+	for (g = 1; g < argc; g++) {
+		if (strcmp (argv[g], "--csv") == 0) {
+			bench_csv = 1;
+		} else if (strcmp (argv[g], "--reps") == 0 && g + 1 < argc) {
+			bench_reps = atoi (argv[++g]);
+			if (bench_reps < 1) bench_reps = 1;
+			if (bench_reps > BENCH_MAX_REPS) bench_reps = BENCH_MAX_REPS;
+		} else if (strcmp (argv[g], "--warmup") == 0 && g + 1 < argc) {
+			bench_warmup = atoi (argv[++g]);
+			if (bench_warmup < 0) bench_warmup = 0;
+		} else if (strcmp (argv[g], "--filter") == 0 && g + 1 < argc) {
+			bench_filter = argv[++g];
+		} else if (strcmp (argv[g], "--data") == 0 && g + 1 < argc) {
+			bench_data = argv[++g];
+		} else {
+			bench_usage (argv[0]);
+			return (strcmp (argv[g], "--help") == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+	
+	initSystemPaths (argv[0]);
+	if (bench_data == NULL) bench_data = get_systemdata_path ();
+	
+	if (SDL_Init (0) < 0 || TTF_Init () < 0) {
+		fprintf (stderr, "Error: Can't initialize SDL\n");
+		return EXIT_FAILURE;
+	}
+	
+	/* El zoom reparte las imágenes grandes entre los hilos, como en el juego */
+	workers_init (0);
+	
+	if (bench_csv) {
+		printf ("kernel,case,ops_per_call,calls_per_rep,reps,median_ns,min_ns,max_ns\n");
+	} else {
+		printf ("%-10s %-36s %12s %12s %12s\n", "kernel", "case", "median ns", "min ns", "max ns");
+	}
+	
+	/* Colisiones: cada objeto contra los 10 pingüinos en una rejilla */
+	for (g = 0; g < 10; g++) {
+		collide.penguins[g] = bench_load_collider (bench_penguin_colliders[g]);
+	}
+	
+	collide.object = bench_load_collider ("collider/bag_3.col");
+	bench_run ("collider", "bag_3", bench_collide, &collide, BENCH_COLLIDE_OPS);
+	collide.object = bench_load_collider ("collider/oneup.col");
+	bench_run ("collider", "oneup", bench_collide, &collide, BENCH_COLLIDE_OPS);
+	collide.object = collider_new_block (9, 45);
+	bench_run ("collider", "block 9x45 (anvil, flower)", bench_collide, &collide, BENCH_COLLIDE_OPS);
+	collide.object = collider_new_block (22, 18);
+	bench_run ("collider", "block 22x18 (fish)", bench_collide, &collide, BENCH_COLLIDE_OPS);
+	
+	/* Blits a una pantalla de 32 bits */
+	blit.screen = SDL_CreateRGBSurface (SDL_SWSURFACE, 760, 480, 32, RMASK, GMASK, BMASK, AMASK);
+	for (g = 0; g < (int) NUM_BENCH_SPRITES; g++) {
+		sprites[g] = bench_load_image (bench_sprites[g]);
+		blit.sprite = sprites[g];
+		
+		blit.alpha = -1;
+		snprintf (name, sizeof (name), "%s %ix%i", strrchr (bench_sprites[g], '/') + 1, sprites[g]->w, sprites[g]->h);
+		bench_run ("blit", name, bench_blit, &blit, 1);
+		
+		blit.alpha = 128;
+		snprintf (name, sizeof (name), "%s %ix%i alpha", strrchr (bench_sprites[g], '/') + 1, sprites[g]->w, sprites[g]->h);
+		bench_run ("blit", name, bench_blit, &blit, 1);
+	}
+	
+	/* Las escalas de la presentación */
+	zoom.smooth = 1;
+	zoom.sprite = bench_load_image ("images/penguin_1_front.png");
+	zoom.scale = 0.7654;
+	bench_run ("zoom", "penguin_1_front.png x0.7654", bench_zoom, &zoom, 1);
+	zoom.sprite = sprites[0];
+	zoom.scale = 0.7596;
+	bench_run ("zoom", "bag_3.png x0.7596", bench_zoom, &zoom, 1);
+	
+	/* Los textos del HUD, con TTF y con el atlas de distancias */
+	snprintf (buffer_file, sizeof (buffer_file), "%s%s", bench_data, "klickclack.ttf");
+	text.font = TTF_OpenFont (buffer_file, 24);
+	text.sdf = sdf_font_new (buffer_file);
+	if (text.font == NULL || text.sdf == NULL) {
+		fprintf (stderr, "Failed to load font file:\n%s\n", buffer_file);
+		return EXIT_FAILURE;
+	}
+	
+	for (g = 0; g < (int) NUM_BENCH_HUD_STRINGS; g++) {
+		text.text = bench_hud_strings[g];
+		
+		snprintf (name, sizeof (name), "ttf \"%s\"", bench_hud_strings[g]);
+		bench_run ("text", name, bench_text_ttf, &text, 1);
+		snprintf (name, sizeof (name), "sdf \"%s\"", bench_hud_strings[g]);
+		bench_run ("text", name, bench_text_sdf, &text, 1);
+	}
+	
+	workers_shutdown ();
+	TTF_Quit ();
+	SDL_Quit ();
+	
+	return EXIT_SUCCESS;
+}
+
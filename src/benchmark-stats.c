@@ -0,0 +1,147 @@
+/*
+ * benchmark-stats.c
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL.h>
+
+#include "benchmark-stats.h"
+
+/*
+ * Tiempos de cada cuadro dibujado en --benchmark.
+ *
+ * Se reservan todos los cuadros desde el principio, así que agregar una
+ * muestra no pide memoria mientras se mide. Al final se reporta el
+ * promedio de cuadros por segundo, un histograma con cubetas que doblan su
+ * tamaño y los cuadros más lentos con su número.
+ */
+
+#define BENCHMARK_BUCKETS 8
+#define BENCHMARK_BAR_WIDTH 40
+
+struct _BenchmarkStats {
+	Uint32 *samples;
+	int count, max;
+};
+
+/* Límite superior de cada cubeta, en microsegundos; la última no tiene */
+static const Uint32 benchmark_bucket_limits[BENCHMARK_BUCKETS - 1] = {
+	1000, 2000, 4000, 8000, 16667, 33333, 66667
+};
+
+BenchmarkStats * benchmark_stats_new (int max_frames) {
+	BenchmarkStats *stats;
+	
+	stats = (BenchmarkStats *) malloc (sizeof (BenchmarkStats));
+	if (stats == NULL) return NULL;
+	
+	stats->samples = (Uint32 *) malloc (sizeof (Uint32) * max_frames);
+	if (stats->samples == NULL) {
+		free (stats);
+		return NULL;
+	}
+	
+	stats->count = 0;
+	stats->max = max_frames;
+	
+	return stats;
+}
+
+void benchmark_stats_free (BenchmarkStats *stats) {
+	if (stats == NULL) return;
+	
+	free (stats->samples);
+	free (stats);
+}
+
+void benchmark_stats_add (BenchmarkStats *stats, Uint64 us) {
+	if (stats->count == stats->max) return;
+	
+	stats->samples[stats->count++] = (us > 0xFFFFFFFFU ? 0xFFFFFFFFU : (Uint32) us);
+}
+
+void benchmark_stats_report (BenchmarkStats *stats, Uint64 elapsed_us, FILE *f) {
+	int buckets[BENCHMARK_BUCKETS];
+	int slowest[BENCHMARK_SLOWEST];
+	int n_slowest = 0;
+	Uint64 total = 0;
+	int g, h, most, bar;
+	
+	if (stats->count == 0) {
+		fprintf (f, "Benchmark: no frames were drawn\n");
+		return;
+	}
+	
+	memset (buckets, 0, sizeof (buckets));
+	
+	for (g = 0; g < stats->count; g++) {
+		total += stats->samples[g];
+		
+		for (h = 0; h < BENCHMARK_BUCKETS - 1; h++) {
+			if (stats->samples[g] < benchmark_bucket_limits[h]) break;
+		}
+		buckets[h]++;
+		
+		/* Los más lentos, ordenados de mayor a menor */
+		for (h = n_slowest; h > 0 && stats->samples[slowest[h - 1]] < stats->samples[g]; h--) {
+			if (h < BENCHMARK_SLOWEST) slowest[h] = slowest[h - 1];
+		}
+		if (h < BENCHMARK_SLOWEST) {
+			slowest[h] = g;
+			if (n_slowest < BENCHMARK_SLOWEST) n_slowest++;
+		}
+	}
+	
+	fprintf (f, "Benchmark: %i frames in %.3f s\n", stats->count, elapsed_us / 1000000.0);
+	fprintf (f, "Average FPS: %.1f (%.3f ms per frame drawn)\n", stats->count * 1000000.0 / elapsed_us, total / 1000.0 / stats->count);
+	
+	most = 0;
+	for (g = 0; g < BENCHMARK_BUCKETS; g++) {
+		if (buckets[g] > most) most = buckets[g];
+	}
+	
+	fprintf (f, "\nFrame time histogram\n");
+	for (g = 0; g < BENCHMARK_BUCKETS; g++) {
+		if (g == 0) {
+			fprintf (f, "%8s < %6.2f ms", "", benchmark_bucket_limits[g] / 1000.0);
+		} else if (g == BENCHMARK_BUCKETS - 1) {
+			fprintf (f, "%8s >= %5.2f ms", "", benchmark_bucket_limits[g - 1] / 1000.0);
+		} else {
+			fprintf (f, "%5.2f - %6.2f ms", benchmark_bucket_limits[g - 1] / 1000.0, benchmark_bucket_limits[g] / 1000.0);
+		}
+		
+		fprintf (f, " %7i ", buckets[g]);
+		bar = (buckets[g] * BENCHMARK_BAR_WIDTH + most - 1) / most;
+		for (h = 0; h < bar; h++) {
+			fputc ('#', f);
+		}
+		fputc ('\n', f);
+	}
+	
+	fprintf (f, "\nSlowest frames\n");
+	for (g = 0; g < n_slowest; g++) {
+		fprintf (f, "%8i %9.3f ms\n", slowest[g], stats->samples[slowest[g]] / 1000.0);
+	}
+}
+
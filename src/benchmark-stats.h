@@ -0,0 +1,41 @@
+/*
+ * benchmark-stats.h
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef __BENCHMARK_STATS_H__
+#define __BENCHMARK_STATS_H__
+
+#include <stdio.h>
+
+#include <SDL.h>
+
+/* Cuántos de los cuadros más lentos se listan */
+#define BENCHMARK_SLOWEST 10
+
+typedef struct _BenchmarkStats BenchmarkStats;
+
+BenchmarkStats * benchmark_stats_new (int max_frames);
+void benchmark_stats_free (BenchmarkStats *stats);
+void benchmark_stats_add (BenchmarkStats *stats, Uint64 us);
+void benchmark_stats_report (BenchmarkStats *stats, Uint64 elapsed_us, FILE *f);
+
+#endif /* __BENCHMARK_STATS_H__ */
+
@@ -0,0 +1,398 @@
+/*
+ * compositor.c
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <stdlib.h>
+
+#include <SDL.h>
+
+#include "compositor.h"
+#include "gfx_blit_func.h"
+#include "sdl2_rect.h"
+#include "workers.h"
+
+/*
+ * Dibujar un cuadro repartido en mosaicos.
+ *
+ * Las llamadas a compositor_blit y compositor_blit_alpha se guardan en una
+ * lista, ya recortadas como lo harían SDL_BlitSurface y
+ * SDL_gfxBlitRGBAWithAlpha. Cada una se anota en los mosaicos de
+ * COMPOSITOR_TILE x COMPOSITOR_TILE que toca. Al vaciar la lista, cada hilo
+ * toma un mosaico y repite en orden sus dibujos, recortados al mosaico,
+ * con las mismas funciones de SDL. Como cada pixel sólo depende de sí mismo,
+ * el resultado es idéntico a dibujar todo en un hilo.
+ *
+ * Si el destino necesita bloquearse, cada llamada se dibuja en el momento,
+ * igual que antes. Sin hilos, workers_run repite los mosaicos uno tras otro.
+ * Si alguna imagen necesita bloquearse (RLE), la lista se dibuja en un solo
+ * hilo.
+ *
+ * compositor_flush_tiles repite sólo los mosaicos marcados, para quien ya
+ * sabe qué partes de la pantalla cambiaron.
+ *
+ * Dentro de un mosaico se saltan los dibujos que un dibujo opaco posterior
+ * tapa por completo: un SDL_BlitSurface de una imagen sin alfa ni color
+ * transparente reemplaza los pixeles sin leerlos.
+ */
+
+enum {
+	COMPOSITOR_OP_BLIT,
+	COMPOSITOR_OP_BLIT_ALPHA
+};
+
+typedef struct {
+	SDL_Surface *src;
+	SDL_Rect srcrect, dstrect;
+	int kind;
+	int opaque;
+	Uint8 alpha;
+} CompositorOp;
+
+typedef struct {
+	int *ops;
+	int n, max;
+} CompositorTile;
+
+struct _Compositor {
+	SDL_Surface *dst;
+	int cols, rows;
+	
+	CompositorOp *ops;
+	int n_ops, max_ops;
+	int serial;
+	
+	CompositorTile *tiles;
+	const Uint8 *mask;
+};
+
+Compositor * compositor_new (SDL_Surface *dst) {
+	Compositor *comp;
+	
+	comp = (Compositor *) malloc (sizeof (Compositor));
+	if (comp == NULL) return NULL;
+	
+	comp->dst = dst;
+	comp->cols = (dst->w + COMPOSITOR_TILE - 1) / COMPOSITOR_TILE;
+	comp->rows = (dst->h + COMPOSITOR_TILE - 1) / COMPOSITOR_TILE;
+	comp->ops = NULL;
+	comp->n_ops = comp->max_ops = 0;
+	comp->serial = 0;
+	comp->mask = NULL;
+	
+	comp->tiles = (CompositorTile *) calloc (comp->cols * comp->rows, sizeof (CompositorTile));
+	if (comp->tiles == NULL) {
+		free (comp);
+		return NULL;
+	}
+	
+	return comp;
+}
+
+void compositor_free (Compositor *comp) {
+	int g;
+	
+	if (comp == NULL) return;
+	
+	for (g = 0; g < comp->cols * comp->rows; g++) {
+		free (comp->tiles[g].ops);
+	}
+	
+	free (comp->tiles);
+	free (comp->ops);
+	free (comp);
+}
+
+static int compositor_direct (Compositor *comp) {
+	return SDL_MUSTLOCK (comp->dst);
+}
+
+static void compositor_run_op (Compositor *comp, CompositorOp *op, SDL_Rect *srcrect, SDL_Rect *dstrect) {
+	if (op->kind == COMPOSITOR_OP_BLIT_ALPHA) {
+		SDL_gfxBlitRGBAWithAlpha (op->src, srcrect, comp->dst, dstrect, op->alpha);
+	} else {
+		SDL_BlitSurface (op->src, srcrect, comp->dst, dstrect);
+	}
+}
+
+/* Mismo recorte que SDL_UpperBlit, devuelve 0 si no queda nada */
+static int compositor_clip (SDL_Surface *src, SDL_Rect *srcrect, SDL_Surface *dst, SDL_Rect *dstrect, SDL_Rect *sr, SDL_Rect *dr) {
+	SDL_Rect *clip = &dst->clip_rect;
+	int sx, sy, dx, dy, w, h, d;
+	
+	dx = (dstrect != NULL ? dstrect->x : 0);
+	dy = (dstrect != NULL ? dstrect->y : 0);
+	
+	if (srcrect != NULL) {
+		sx = srcrect->x;
+		sy = srcrect->y;
+		w = srcrect->w;
+		h = srcrect->h;
+		if (sx < 0) {
+			w += sx;
+			dx -= sx;
+			sx = 0;
+		}
+		if (sy < 0) {
+			h += sy;
+			dy -= sy;
+			sy = 0;
+		}
+		if (src->w - sx < w) w = src->w - sx;
+		if (src->h - sy < h) h = src->h - sy;
+	} else {
+		sx = sy = 0;
+		w = src->w;
+		h = src->h;
+	}
+	
+	d = clip->x - dx;
+	if (d > 0) {
+		w -= d;
+		dx += d;
+		sx += d;
+	}
+	d = dx + w - clip->x - clip->w;
+	if (d > 0) w -= d;
+	
+	d = clip->y - dy;
+	if (d > 0) {
+		h -= d;
+		dy += d;
+		sy += d;
+	}
+	d = dy + h - clip->y - clip->h;
+	if (d > 0) h -= d;
+	
+	if (w <= 0 || h <= 0) return 0;
+	
+	sr->x = sx;
+	sr->y = sy;
+	sr->w = w;
+	sr->h = h;
+	dr->x = dx;
+	dr->y = dy;
+	dr->w = w;
+	dr->h = h;
+	
+	return 1;
+}
+
+static int compositor_tile_add (CompositorTile *tile, int op) {
+	int *bigger;
+	
+	if (tile->n == tile->max) {
+		bigger = (int *) realloc (tile->ops, (tile->max + 32) * sizeof (int));
+		if (bigger == NULL) return -1;
+		tile->ops = bigger;
+		tile->max += 32;
+	}
+	
+	tile->ops[tile->n++] = op;
+	
+	return 0;
+}
+
+static void compositor_record (Compositor *comp, int kind, SDL_Surface *src, SDL_Rect *srcrect, SDL_Rect *dstrect, Uint8 alpha) {
+	CompositorOp *op, *bigger;
+	SDL_Rect sr, dr, zero;
+	int tx, ty, tx1, ty1;
+	
+	if (!compositor_clip (src, srcrect, comp->dst, dstrect, &sr, &dr)) return;
+	
+	if (comp->n_ops == comp->max_ops) {
+		bigger = (CompositorOp *) realloc (comp->ops, (comp->max_ops + 64) * sizeof (CompositorOp));
+		if (bigger == NULL) {
+			/* Sin memoria para guardarlo, se dibuja lo pendiente y éste */
+			compositor_flush (comp);
+			if (kind == COMPOSITOR_OP_BLIT_ALPHA) {
+				SDL_gfxBlitRGBAWithAlpha (src, &sr, comp->dst, &dr, alpha);
+			} else {
+				SDL_BlitSurface (src, &sr, comp->dst, &dr);
+			}
+			return;
+		}
+		comp->ops = bigger;
+		comp->max_ops += 64;
+	}
+	
+	op = &comp->ops[comp->n_ops];
+	op->src = src;
+	op->srcrect = sr;
+	op->dstrect = dr;
+	op->kind = kind;
+	op->alpha = alpha;
+	op->opaque = (kind == COMPOSITOR_OP_BLIT && (src->flags & (SDL_SRCALPHA | SDL_SRCCOLORKEY)) == 0);
+	
+	if (SDL_MUSTLOCK (src)) {
+		comp->serial = 1;
+	} else if (kind == COMPOSITOR_OP_BLIT) {
+		/* SDL prepara el mapeo de colores en el primer blit hacia un
+		 * destino; se hace aquí con un blit vacío y no en los hilos */
+		zero.x = zero.y = 0;
+		zero.w = zero.h = 0;
+		SDL_LowerBlit (src, &zero, comp->dst, &zero);
+	}
+	
+	tx1 = (dr.x + dr.w - 1) / COMPOSITOR_TILE;
+	ty1 = (dr.y + dr.h - 1) / COMPOSITOR_TILE;
+	for (ty = dr.y / COMPOSITOR_TILE; ty <= ty1; ty++) {
+		for (tx = dr.x / COMPOSITOR_TILE; tx <= tx1; tx++) {
+			if (compositor_tile_add (&comp->tiles[ty * comp->cols + tx], comp->n_ops) < 0) {
+				/* Sin la lista del mosaico sólo queda dibujar en orden */
+				comp->serial = 1;
+			}
+		}
+	}
+	
+	comp->n_ops++;
+}
+
+void compositor_blit (Compositor *comp, SDL_Surface *src, SDL_Rect *srcrect, SDL_Rect *dstrect) {
+	if (compositor_direct (comp)) {
+		SDL_BlitSurface (src, srcrect, comp->dst, dstrect);
+		return;
+	}
+	
+	compositor_record (comp, COMPOSITOR_OP_BLIT, src, srcrect, dstrect, 255);
+}
+
+void compositor_blit_alpha (Compositor *comp, SDL_Surface *src, SDL_Rect *srcrect, SDL_Rect *dstrect, Uint8 alpha) {
+	if (compositor_direct (comp)) {
+		SDL_gfxBlitRGBAWithAlpha (src, srcrect, comp->dst, dstrect, alpha);
+		return;
+	}
+	
+	compositor_record (comp, COMPOSITOR_OP_BLIT_ALPHA, src, srcrect, dstrect, alpha);
+}
+
+/* Revisa si un dibujo posterior del mosaico tapa por completo a part */
+static int compositor_covered (Compositor *comp, CompositorTile *tile, int g, SDL_Rect *part) {
+	SDL_Rect *d;
+	int h;
+	
+	for (h = g + 1; h < tile->n; h++) {
+		if (!comp->ops[tile->ops[h]].opaque) continue;
+		
+		d = &comp->ops[tile->ops[h]].dstrect;
+		if (d->x <= part->x && d->y <= part->y && d->x + d->w >= part->x + part->w && d->y + d->h >= part->y + part->h) return 1;
+	}
+	
+	return 0;
+}
+
+static void compositor_tile (void *data, int item) {
+	Compositor *comp = (Compositor *) data;
+	CompositorTile *tile = &comp->tiles[item];
+	CompositorOp *op;
+	SDL_Rect area, part, sr;
+	int g;
+	
+	area.x = (item % comp->cols) * COMPOSITOR_TILE;
+	area.y = (item / comp->cols) * COMPOSITOR_TILE;
+	area.w = COMPOSITOR_TILE;
+	area.h = COMPOSITOR_TILE;
+	
+	if (comp->mask != NULL && !comp->mask[item]) {
+		tile->n = 0;
+		return;
+	}
+	
+	for (g = 0; g < tile->n; g++) {
+		op = &comp->ops[tile->ops[g]];
+		if (!SDL_IntersectRect (&op->dstrect, &area, &part)) continue;
+		if (compositor_covered (comp, tile, g, &part)) continue;
+		
+		sr.x = op->srcrect.x + (part.x - op->dstrect.x);
+		sr.y = op->srcrect.y + (part.y - op->dstrect.y);
+		sr.w = part.w;
+		sr.h = part.h;
+		
+		compositor_run_op (comp, op, &sr, &part);
+	}
+	
+	tile->n = 0;
+}
+
+static void compositor_serial (Compositor *comp) {
+	SDL_Rect area, part, sr;
+	CompositorOp *op;
+	int g, t;
+	
+	if (comp->mask == NULL) {
+		for (g = 0; g < comp->n_ops; g++) {
+			sr = comp->ops[g].srcrect;
+			part = comp->ops[g].dstrect;
+			compositor_run_op (comp, &comp->ops[g], &sr, &part);
+		}
+	} else {
+		/* Las listas de los mosaicos pueden estar incompletas, se revisan
+		 * todos los dibujos contra cada mosaico marcado */
+		for (t = 0; t < comp->cols * comp->rows; t++) {
+			if (!comp->mask[t]) continue;
+			
+			area.x = (t % comp->cols) * COMPOSITOR_TILE;
+			area.y = (t / comp->cols) * COMPOSITOR_TILE;
+			area.w = COMPOSITOR_TILE;
+			area.h = COMPOSITOR_TILE;
+			
+			for (g = 0; g < comp->n_ops; g++) {
+				op = &comp->ops[g];
+				if (!SDL_IntersectRect (&op->dstrect, &area, &part)) continue;
+				
+				sr.x = op->srcrect.x + (part.x - op->dstrect.x);
+				sr.y = op->srcrect.y + (part.y - op->dstrect.y);
+				sr.w = part.w;
+				sr.h = part.h;
+				
+				compositor_run_op (comp, op, &sr, &part);
+			}
+		}
+	}
+	
+	for (g = 0; g < comp->cols * comp->rows; g++) {
+		comp->tiles[g].n = 0;
+	}
+}
+
+static void compositor_replay (Compositor *comp, const Uint8 *mask) {
+	if (comp->n_ops == 0) return;
+	
+	comp->mask = mask;
+	if (comp->serial) {
+		compositor_serial (comp);
+	} else {
+		workers_run (compositor_tile, comp, comp->cols * comp->rows);
+	}
+	comp->mask = NULL;
+	
+	comp->n_ops = 0;
+	comp->serial = 0;
+}
+
+void compositor_flush (Compositor *comp) {
+	compositor_replay (comp, NULL);
+}
+
+/* mask trae un byte por mosaico, en orden de renglón */
+void compositor_flush_tiles (Compositor *comp, const Uint8 *mask) {
+	compositor_replay (comp, mask);
+}
+
@@ -0,0 +1,40 @@
+/*
+ * compositor.h
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef __COMPOSITOR_H__
+#define __COMPOSITOR_H__
+
+#include <SDL.h>
+
+#define COMPOSITOR_TILE 64
+
+typedef struct _Compositor Compositor;
+
+Compositor * compositor_new (SDL_Surface *dst);
+void compositor_free (Compositor *comp);
+void compositor_blit (Compositor *comp, SDL_Surface *src, SDL_Rect *srcrect, SDL_Rect *dstrect);
+void compositor_blit_alpha (Compositor *comp, SDL_Surface *src, SDL_Rect *srcrect, SDL_Rect *dstrect, Uint8 alpha);
+void compositor_flush (Compositor *comp);
+void compositor_flush_tiles (Compositor *comp, const Uint8 *mask);
+
+#endif /* __COMPOSITOR_H__ */
+
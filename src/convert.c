@@ -0,0 +1,205 @@
+/*
+ * convert.c
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <SDL.h>
+
+#if defined (__GNUC__) && (defined (__i386__) || defined (__x86_64__))
+#define CONVERT_HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "convert.h"
+#include "workers.h"
+
+/*
+ * Pasar un cuadro de 32 bits a una pantalla de 16 bits.
+ *
+ * Cada canal se trunca a los bits del destino. Con dither se suma antes un
+ * umbral de una matriz de Bayer de 4x4, escalado a los bits que se pierden en
+ * ese canal; el patrón depende de la posición absoluta del pixel, así que
+ * convertir por rectángulos da lo mismo que convertir todo.
+ *
+ * El caso común (RGBA en orden de bytes a RGB565) tiene una versión SSE2 de
+ * 8 pixeles por paso; los demás formatos usan el camino general. El trabajo
+ * se reparte por bandas de renglones entre los hilos de workers.c.
+ */
+
+#define CONVERT_BAND_ROWS 32
+
+typedef struct {
+	SDL_Surface *src, *dst;
+	SDL_Rect rect;
+	int dither;
+} ConvertJob;
+
+static const Uint8 convert_bayer[4][4] = {
+	{ 0,  8,  2, 10},
+	{12,  4, 14,  6},
+	{ 3, 11,  1,  9},
+	{15,  7, 13,  5}
+};
+
+static int convert_use_sse2 = -1;
+
+static inline Uint16 convert_pixel (Uint32 p, SDL_PixelFormat *sf, SDL_PixelFormat *df, int d) {
+	int r, g, b;
+	
+	r = (p >> sf->Rshift) & 0xff;
+	g = (p >> sf->Gshift) & 0xff;
+	b = (p >> sf->Bshift) & 0xff;
+	
+	if (d >= 0) {
+		r += (d << df->Rloss) >> 4;
+		g += (d << df->Gloss) >> 4;
+		b += (d << df->Bloss) >> 4;
+		if (r > 255) r = 255;
+		if (g > 255) g = 255;
+		if (b > 255) b = 255;
+	}
+	
+	return ((r >> df->Rloss) << df->Rshift) | ((g >> df->Gloss) << df->Gshift) | ((b >> df->Bloss) << df->Bshift);
+}
+
+#ifdef CONVERT_HAVE_SSE2
+/* RGBA (R en el primer byte) a RGB565, x debe ser múltiplo de 4 */
+__attribute__ ((target ("sse2")))
+static int convert_row_sse2 (const Uint32 *s, Uint16 *d, int x, int last, int y, int dither) {
+	__m128i v0, v1, r, g, b, bias, pattern, mr, mg, mb;
+	Uint8 t[16];
+	int k;
+	
+	/* Umbrales de los 4 pixeles del renglón: 3 bits para R y B, 2 para G */
+	for (k = 0; k < 4; k++) {
+		t[k * 4] = dither ? (convert_bayer[y & 3][k] << 3) >> 4 : 0;
+		t[k * 4 + 1] = dither ? (convert_bayer[y & 3][k] << 2) >> 4 : 0;
+		t[k * 4 + 2] = t[k * 4];
+		t[k * 4 + 3] = 0;
+	}
+	pattern = _mm_loadu_si128 ((const __m128i *) t);
+	
+	mr = _mm_set1_epi32 (0xf8);
+	mg = _mm_set1_epi32 (0xfc00);
+	mb = _mm_set1_epi32 (0xf80000);
+	bias = _mm_set1_epi32 (0x8000);
+	
+	for (; x + 8 <= last; x += 8) {
+		v0 = _mm_adds_epu8 (_mm_loadu_si128 ((const __m128i *) &s[x]), pattern);
+		v1 = _mm_adds_epu8 (_mm_loadu_si128 ((const __m128i *) &s[x + 4]), pattern);
+		
+		r = _mm_slli_epi32 (_mm_and_si128 (v0, mr), 8);
+		g = _mm_srli_epi32 (_mm_and_si128 (v0, mg), 5);
+		b = _mm_srli_epi32 (_mm_and_si128 (v0, mb), 19);
+		v0 = _mm_sub_epi32 (_mm_or_si128 (r, _mm_or_si128 (g, b)), bias);
+		
+		r = _mm_slli_epi32 (_mm_and_si128 (v1, mr), 8);
+		g = _mm_srli_epi32 (_mm_and_si128 (v1, mg), 5);
+		b = _mm_srli_epi32 (_mm_and_si128 (v1, mb), 19);
+		v1 = _mm_sub_epi32 (_mm_or_si128 (r, _mm_or_si128 (g, b)), bias);
+		
+		/* El empaquetado es con signo, se corre el rango y se regresa */
+		_mm_storeu_si128 ((__m128i *) &d[x], _mm_add_epi16 (_mm_packs_epi32 (v0, v1), _mm_set1_epi16 ((short) 0x8000)));
+	}
+	
+	return x;
+}
+#endif
+
+static void convert_band (void *data, int band) {
+	ConvertJob *job = (ConvertJob *) data;
+	SDL_PixelFormat *sf = job->src->format, *df = job->dst->format;
+	const Uint32 *s;
+	Uint16 *d;
+	int x, y, last_x, last_y, fast;
+	
+	fast = 0;
+#ifdef CONVERT_HAVE_SSE2
+	fast = convert_use_sse2 && sf->Rmask == 0x000000ff && sf->Gmask == 0x0000ff00 && sf->Bmask == 0x00ff0000 &&
+	       df->Rmask == 0xf800 && df->Gmask == 0x07e0 && df->Bmask == 0x001f;
+#endif
+	
+	y = job->rect.y + band * CONVERT_BAND_ROWS;
+	last_y = y + CONVERT_BAND_ROWS;
+	if (last_y > job->rect.y + job->rect.h) last_y = job->rect.y + job->rect.h;
+	last_x = job->rect.x + job->rect.w;
+	
+	for (; y < last_y; y++) {
+		s = (const Uint32 *) ((const Uint8 *) job->src->pixels + y * job->src->pitch);
+		d = (Uint16 *) ((Uint8 *) job->dst->pixels + y * job->dst->pitch);
+		x = job->rect.x;
+		
+#ifdef CONVERT_HAVE_SSE2
+		if (fast) {
+			for (; (x & 3) != 0 && x < last_x; x++) {
+				d[x] = convert_pixel (s[x], sf, df, job->dither ? convert_bayer[y & 3][x & 3] : -1);
+			}
+			x = convert_row_sse2 (s, d, x, last_x, y, job->dither);
+		}
+#endif
+		
+		for (; x < last_x; x++) {
+			d[x] = convert_pixel (s[x], sf, df, job->dither ? convert_bayer[y & 3][x & 3] : -1);
+		}
+	}
+}
+
+int convert_32_to_16 (SDL_Surface *src, SDL_Rect *rect, SDL_Surface *dst, int dither) {
+	ConvertJob job;
+	int x0, y0, x1, y1;
+	
+	if (src->format->BytesPerPixel != 4 || dst->format->BytesPerPixel != 2) return -1;
+	if (dst->w < src->w || dst->h < src->h) return -1;
+	
+	if (convert_use_sse2 < 0) {
+		convert_use_sse2 = 0;
+#ifdef CONVERT_HAVE_SSE2
+		__builtin_cpu_init ();
+		convert_use_sse2 = __builtin_cpu_supports ("sse2");
+#endif
+	}
+	
+	/* Recortar con enteros con signo, igual que scaler_blit */
+	if (rect == NULL) {
+		x0 = y0 = 0;
+		x1 = src->w;
+		y1 = src->h;
+	} else {
+		x0 = (rect->x > 0 ? rect->x : 0);
+		y0 = (rect->y > 0 ? rect->y : 0);
+		x1 = (rect->x + rect->w < src->w ? rect->x + rect->w : src->w);
+		y1 = (rect->y + rect->h < src->h ? rect->y + rect->h : src->h);
+	}
+	if (x1 <= x0 || y1 <= y0) return 0;
+	
+	job.rect.x = x0;
+	job.rect.y = y0;
+	job.rect.w = x1 - x0;
+	job.rect.h = y1 - y0;
+	
+	job.src = src;
+	job.dst = dst;
+	job.dither = dither;
+	
+	workers_run (convert_band, &job, (job.rect.h + CONVERT_BAND_ROWS - 1) / CONVERT_BAND_ROWS);
+	
+	return 0;
+}
+
@@ -0,0 +1,178 @@
+/*
+ * digit-glyphs.c
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL.h>
+
+#include "sdf-text.h"
+#include "digit-glyphs.h"
+
+/*
+ * Números del HUD armados con los dígitos 0-9 ya renderizados.
+ *
+ * Igual que draw_text_with_shadow, cada número tiene una capa con el
+ * contorno y otra con el relleno encima. Se guardan por separado para
+ * dibujar primero todos los contornos y luego todos los rellenos, así el
+ * contorno de un dígito no tapa al dígito anterior.
+ */
+
+struct _DigitGlyphs {
+	SDL_Surface *fill[10];
+	SDL_Surface *outline[10];
+	int advance[10];
+	int border;
+};
+
+DigitGlyphs * digit_glyphs_new (SDFFont *font, double size, int outline, SDL_Color foreground, SDL_Color background) {
+	DigitGlyphs *glyphs;
+	SDFStyle style;
+	char text[2];
+	int g;
+	
+	glyphs = (DigitGlyphs *) malloc (sizeof (DigitGlyphs));
+	if (glyphs == NULL) return NULL;
+	
+	glyphs->border = outline;
+	for (g = 0; g < 10; g++) {
+		glyphs->fill[g] = glyphs->outline[g] = NULL;
+	}
+	
+	/* La capa del contorno es la letra completa en el color de fondo */
+	memset (&style, 0, sizeof (style));
+	style.size = size;
+	style.fill = background;
+	style.outline = outline;
+	style.outline_color = background;
+	
+	text[1] = '\0';
+	
+	for (g = 0; g < 10; g++) {
+		text[0] = '0' + g;
+		
+		glyphs->outline[g] = sdf_render (font, text, &style);
+		glyphs->fill[g] = sdf_draw_text (font, size, text, foreground);
+		
+		if (glyphs->outline[g] == NULL || glyphs->fill[g] == NULL) {
+			digit_glyphs_free (glyphs);
+			return NULL;
+		}
+		
+		/* El relleno no lleva margen, su ancho es el avance del dígito */
+		glyphs->advance[g] = glyphs->fill[g]->w;
+	}
+	
+	return glyphs;
+}
+
+/* Arma los dígitos con capas ya renderizadas: 10 contornos y luego 10 rellenos */
+DigitGlyphs * digit_glyphs_new_from_layers (SDL_Surface **layers, int outline) {
+	DigitGlyphs *glyphs;
+	int g;
+	
+	glyphs = (DigitGlyphs *) malloc (sizeof (DigitGlyphs));
+	if (glyphs == NULL) return NULL;
+	
+	glyphs->border = outline;
+	for (g = 0; g < 10; g++) {
+		glyphs->outline[g] = layers[g];
+		glyphs->fill[g] = layers[10 + g];
+		glyphs->advance[g] = glyphs->fill[g]->w;
+	}
+	
+	return glyphs;
+}
+
+void digit_glyphs_layers (DigitGlyphs *glyphs, SDL_Surface **layers) {
+	int g;
+	
+	for (g = 0; g < 10; g++) {
+		layers[g] = glyphs->outline[g];
+		layers[10 + g] = glyphs->fill[g];
+	}
+}
+
+void digit_glyphs_free (DigitGlyphs *glyphs) {
+	int g;
+	
+	if (glyphs == NULL) return;
+	
+	for (g = 0; g < 10; g++) {
+		if (glyphs->fill[g] != NULL) SDL_FreeSurface (glyphs->fill[g]);
+		if (glyphs->outline[g] != NULL) SDL_FreeSurface (glyphs->outline[g]);
+	}
+	
+	free (glyphs);
+}
+
+/* Separa el número en dígitos, del más significativo al menos */
+static int digit_glyphs_split (int value, int *digits) {
+	int tmp[12];
+	int n, g;
+	
+	if (value < 0) value = 0;
+	
+	n = 0;
+	do {
+		tmp[n++] = value % 10;
+		value = value / 10;
+	} while (value > 0);
+	
+	for (g = 0; g < n; g++) {
+		digits[g] = tmp[n - 1 - g];
+	}
+	
+	return n;
+}
+
+/* Una capa suelta, con el mismo número que le pasa digit_glyphs_foreach */
+SDL_Surface * digit_glyphs_glyph (DigitGlyphs *glyphs, int glyph) {
+	if (glyph < 0 || glyph >= 20) return NULL;
+	
+	if (glyph < 10) return glyphs->outline[glyph];
+	
+	return glyphs->fill[glyph - 10];
+}
+
+/* Llama a func por cada capa de cada dígito, en el orden en que se dibujan */
+void digit_glyphs_foreach (DigitGlyphs *glyphs, int value, int x, int y, DigitGlyphsFunc func, void *data) {
+	int digits[12];
+	int n, g, pos;
+	
+	n = digit_glyphs_split (value, digits);
+	
+	/* Primero los contornos */
+	pos = x;
+	for (g = 0; g < n; g++) {
+		func (data, digits[g], glyphs->outline[digits[g]], pos, y);
+		pos += glyphs->advance[digits[g]];
+	}
+	
+	/* Luego los rellenos, desplazados por el grosor del contorno */
+	pos = x + glyphs->border;
+	for (g = 0; g < n; g++) {
+		func (data, 10 + digits[g], glyphs->fill[digits[g]], pos, y + glyphs->border);
+		pos += glyphs->advance[digits[g]];
+	}
+}
+
@@ -0,0 +1,43 @@
+/*
+ * digit-glyphs.h
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef __DIGIT_GLYPHS_H__
+#define __DIGIT_GLYPHS_H__
+
+#include <SDL.h>
+
+#include "sdf-text.h"
+
+typedef struct _DigitGlyphs DigitGlyphs;
+
+/* glyph es 0-9 para los contornos y 10-19 para los rellenos */
+typedef void (*DigitGlyphsFunc) (void *data, int glyph, SDL_Surface *surface, int x, int y);
+
+DigitGlyphs * digit_glyphs_new (SDFFont *font, double size, int outline, SDL_Color foreground, SDL_Color background);
+DigitGlyphs * digit_glyphs_new_from_layers (SDL_Surface **layers, int outline);
+void digit_glyphs_layers (DigitGlyphs *glyphs, SDL_Surface **layers);
+void digit_glyphs_free (DigitGlyphs *glyphs);
+SDL_Surface * digit_glyphs_glyph (DigitGlyphs *glyphs, int glyph);
+void digit_glyphs_foreach (DigitGlyphs *glyphs, int value, int x, int y, DigitGlyphsFunc func, void *data);
+
+#endif /* __DIGIT_GLYPHS_H__ */
+
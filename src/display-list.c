@@ -0,0 +1,151 @@
+/*
+ * display-list.c
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL.h>
+
+#include "display-list.h"
+
+/*
+ * Lista de lo que se dibuja en un cuadro.
+ *
+ * La lógica del juego no dibuja, sólo anota qué imagen va en qué posición,
+ * en qué capa y con qué alfa. Las imágenes se nombran con un número que el
+ * dibujante traduce a superficie, así la lista no guarda apuntadores y se
+ * puede escribir a un archivo para repetir o revisar los cuadros después.
+ *
+ * Cada elemento puede llevar también la posición que tendrá en el siguiente
+ * paso de la simulación, para que el dibujante lo mueva suavemente entre
+ * las dos si dibuja más seguido que la simulación.
+ *
+ * Si falta memoria para crecer la lista, el elemento se pierde y el cuadro
+ * sale incompleto; el siguiente cuadro lo vuelve a intentar. Las funciones
+ * display_item_* aceptan NULL por eso.
+ */
+
+#define DISPLAY_LIST_MAGIC 0x54534C44 /* "DLST" */
+
+typedef struct {
+	Uint32 magic;
+	Uint32 count;
+} DisplayListHeader;
+
+DisplayList * display_list_new (void) {
+	DisplayList *list;
+	
+	list = (DisplayList *) malloc (sizeof (DisplayList));
+	if (list == NULL) return NULL;
+	
+	list->items = NULL;
+	list->count = list->max = 0;
+	
+	return list;
+}
+
+void display_list_free (DisplayList *list) {
+	if (list == NULL) return;
+	
+	free (list->items);
+	free (list);
+}
+
+void display_list_clear (DisplayList *list) {
+	list->count = 0;
+}
+
+static DisplayItem * display_list_append (DisplayList *list) {
+	DisplayItem *bigger;
+	
+	if (list->count == list->max) {
+		bigger = (DisplayItem *) realloc (list->items, (list->max + 64) * sizeof (DisplayItem));
+		if (bigger == NULL) return NULL;
+		list->items = bigger;
+		list->max += 64;
+	}
+	
+	return &list->items[list->count++];
+}
+
+DisplayItem * display_list_add_alpha (DisplayList *list, int layer, int sprite, int x, int y, int alpha) {
+	DisplayItem *item;
+	
+	item = display_list_append (list);
+	if (item == NULL) return NULL;
+	
+	item->sprite = sprite;
+	item->layer = layer;
+	item->x = item->x1 = x;
+	item->y = item->y1 = y;
+	item->alpha = alpha;
+	item->flags = 0;
+	memset (&item->src, 0, sizeof (SDL_Rect));
+	
+	return item;
+}
+
+DisplayItem * display_list_add (DisplayList *list, int layer, int sprite, int x, int y) {
+	return display_list_add_alpha (list, layer, sprite, x, y, DISPLAY_NO_ALPHA);
+}
+
+DisplayItem * display_list_add_part (DisplayList *list, int layer, int sprite, SDL_Rect *src, int x, int y) {
+	DisplayItem *item;
+	
+	if (src->w == 0 || src->h == 0) return NULL;
+	
+	item = display_list_add_alpha (list, layer, sprite, x, y, DISPLAY_NO_ALPHA);
+	if (item == NULL) return NULL;
+	
+	item->src = *src;
+	
+	return item;
+}
+
+void display_item_move (DisplayItem *item, int x1, int y1) {
+	if (item == NULL) return;
+	
+	item->x1 = x1;
+	item->y1 = y1;
+}
+
+/* Con una parte de la imagen, el recorte se recorre junto con el elemento */
+void display_item_follow (DisplayItem *item) {
+	if (item == NULL) return;
+	
+	item->flags |= DISPLAY_FOLLOW;
+}
+
+/* Un cuadro por llamada, en el formato de esta máquina */
+int display_list_write (DisplayList *list, FILE *f) {
+	DisplayListHeader header;
+	
+	header.magic = DISPLAY_LIST_MAGIC;
+	header.count = list->count;
+	
+	if (fwrite (&header, sizeof (header), 1, f) != 1) return -1;
+	if (list->count > 0 && fwrite (list->items, sizeof (DisplayItem), list->count, f) != (size_t) list->count) return -1;
+	
+	return 0;
+}
+
@@ -0,0 +1,65 @@
+/*
+ * display-list.h
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef __DISPLAY_LIST_H__
+#define __DISPLAY_LIST_H__
+
+#include <stdio.h>
+
+#include <SDL.h>
+
+/* Sin alfa global, la imagen se dibuja con SDL_BlitSurface */
+#define DISPLAY_NO_ALPHA -1
+
+/* Fase entre un paso de la simulación y el siguiente, en 1/256 */
+#define DISPLAY_PHASE_ONE 256
+
+/* El elemento se recorre con el desplazamiento que indique el dibujante */
+#define DISPLAY_FOLLOW 0x01
+
+typedef struct {
+	int sprite;
+	int layer;
+	int x, y;
+	int x1, y1; /* Posición en el siguiente paso */
+	int alpha;
+	int flags;
+	SDL_Rect src; /* Con src.w == 0 se dibuja la imagen completa */
+} DisplayItem;
+
+typedef struct {
+	DisplayItem *items;
+	int count, max;
+} DisplayList;
+
+DisplayList * display_list_new (void);
+void display_list_free (DisplayList *list);
+void display_list_clear (DisplayList *list);
+DisplayItem * display_list_add (DisplayList *list, int layer, int sprite, int x, int y);
+DisplayItem * display_list_add_alpha (DisplayList *list, int layer, int sprite, int x, int y, int alpha);
+DisplayItem * display_list_add_part (DisplayList *list, int layer, int sprite, SDL_Rect *src, int x, int y);
+void display_item_move (DisplayItem *item, int x1, int y1);
+void display_item_follow (DisplayItem *item);
+int display_list_write (DisplayList *list, FILE *f);
+
+#endif /* __DISPLAY_LIST_H__ */
+
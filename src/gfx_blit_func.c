@@ -30,6 +30,8 @@ Andreas Schiffler -- aschiffler at ferzkopp dot net
 #include <SDL.h>
 #include <SDL_video.h>
 
+#include "perf-counters.h"
+
 /*!
 \brief Unwrap RGBA values from a pixel using mask, shift and loss for surface.
 */
@@ -536,7 +538,9 @@ int _SDL_gfxBlitRGBACall(SDL_Surface * src, SDL_Rect * srcrect, SDL_Surface * ds
 		/*
 		* Run the actual software blitter 
 		*/
+		PERF_BEGIN (PERF_REGION_GFX_BLIT);
 		_SDL_gfxBlitBlitterRGBA(&info);
+		PERF_END (PERF_REGION_GFX_BLIT);
 		return 1;
 	}
 
@@ -736,7 +740,9 @@ int _SDL_gfxBlitRGBACallWithAlpha(SDL_Surface * src, SDL_Rect * srcrect, SDL_Sur
 		/*
 		* Run the actual software blitter 
 		*/
+		PERF_BEGIN (PERF_REGION_GFX_BLIT);
 		_SDL_gfxBlitBlitterRGBAWithAlpha(&info);
+		PERF_END (PERF_REGION_GFX_BLIT);
 		return 1;
 	}
 
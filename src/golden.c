@@ -0,0 +1,324 @@
+/*
+ * golden.c
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL.h>
+
+#include "gettext.h"
+#define _(string) gettext (string)
+
+#include "golden.h"
+#include "path.h"
+#include "surface-cache.h"
+
+#ifdef HAVE_LIBPNG
+#include "savepng.h"
+#endif
+
+/*
+ * Cuadros de referencia para comparar el dibujo entre versiones.
+ *
+ * Cada cuadro pedido se copia a una superficie de 24 bits, así el hash y
+ * el PNG no dependen del formato de la pantalla ni del relleno de cada
+ * renglón. En la carpeta de salida quedan frame-NNNNN.png y frames.txt,
+ * con un renglón "cuadro hash" por captura. Esa carpeta puede usarse
+ * después como la de referencia: se lee su frames.txt y cada cuadro que
+ * no coincida se reporta. Con una carpeta de referencia también fallan los
+ * cuadros que no estén en su frames.txt, los que no se alcanzaron a dibujar
+ * y la corrida entera si no se puede leer frames.txt.
+ *
+ * Sin libpng sólo se guardan los hashes.
+ */
+
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+#define GOLDEN_RMASK 0xff0000
+#define GOLDEN_GMASK 0x00ff00
+#define GOLDEN_BMASK 0x0000ff
+#else
+#define GOLDEN_RMASK 0x0000ff
+#define GOLDEN_GMASK 0x00ff00
+#define GOLDEN_BMASK 0xff0000
+#endif
+
+typedef struct {
+	int frame;
+	Uint64 hash;
+	int captured;
+	
+	/* De la carpeta de referencia */
+	Uint64 golden;
+	int has_golden;
+} GoldenFrame;
+
+struct _GoldenCapture {
+	GoldenFrame frames[GOLDEN_MAX_FRAMES];
+	int count;
+	
+	/* Con --golden-dir, y si su frames.txt se pudo leer */
+	int has_golden_dir;
+	int golden_failed;
+	
+	char *out_dir;
+	SDL_Surface *copy;
+};
+
+static int golden_compare (const void *a, const void *b) {
+	return ((const GoldenFrame *) a)->frame - ((const GoldenFrame *) b)->frame;
+}
+
+static char * golden_path (const char *dir, const char *name) {
+	char *path;
+	int len;
+	
+	len = strlen (dir);
+	path = (char *) malloc (len + strlen (name) + 2);
+	if (path == NULL) return NULL;
+	
+	strcpy (path, dir);
+	if (len > 0 && dir[len - 1] != '/') strcat (path, "/");
+	strcat (path, name);
+	
+	return path;
+}
+
+static int golden_read_manifest (GoldenCapture *capture, const char *golden_dir) {
+	char *filename;
+	FILE *f;
+	unsigned long long hash;
+	int frame, g;
+	
+	filename = golden_path (golden_dir, "frames.txt");
+	if (filename == NULL) return -1;
+	
+	f = fopen (filename, "r");
+	if (f == NULL) {
+		fprintf (stderr, _("Golden frames: can't read %s\n"), filename);
+		free (filename);
+		return -1;
+	}
+	
+	while (fscanf (f, "%i %llx", &frame, &hash) == 2) {
+		for (g = 0; g < capture->count; g++) {
+			if (capture->frames[g].frame == frame) {
+				capture->frames[g].golden = hash;
+				capture->frames[g].has_golden = 1;
+			}
+		}
+	}
+	
+	fclose (f);
+	free (filename);
+	
+	return 0;
+}
+
+/* frames es una lista separada por comas, como "10,200,480" */
+GoldenCapture * golden_capture_new (const char *frames, const char *out_dir, const char *golden_dir) {
+	GoldenCapture *capture;
+	const char *p;
+	char *end;
+	long frame;
+	
+	capture = (GoldenCapture *) calloc (1, sizeof (GoldenCapture));
+	if (capture == NULL) return NULL;
+	
+	for (p = frames; *p != 0 && capture->count < GOLDEN_MAX_FRAMES; p = end) {
+		frame = strtol (p, &end, 10);
+		if (end == p) {
+			end++;
+			continue;
+		}
+		if (frame >= 0) capture->frames[capture->count++].frame = (int) frame;
+		if (*end == ',') end++;
+	}
+	
+	qsort (capture->frames, capture->count, sizeof (GoldenFrame), golden_compare);
+	
+	if (out_dir != NULL && folder_create (out_dir)) {
+		capture->out_dir = strdup (out_dir);
+	} else if (out_dir != NULL) {
+		fprintf (stderr, _("Golden frames: can't create %s\n"), out_dir);
+	}
+	
+	if (golden_dir != NULL) {
+		capture->has_golden_dir = 1;
+		if (golden_read_manifest (capture, golden_dir) < 0) capture->golden_failed = 1;
+	}
+	
+	return capture;
+}
+
+void golden_capture_free (GoldenCapture *capture) {
+	if (capture == NULL) return;
+	
+	if (capture->copy != NULL) SDL_FreeSurface (capture->copy);
+	free (capture->out_dir);
+	free (capture);
+}
+
+int golden_capture_last (GoldenCapture *capture) {
+	if (capture->count == 0) return -1;
+	
+	return capture->frames[capture->count - 1].frame;
+}
+
+int golden_capture_wants (GoldenCapture *capture, int frame) {
+	int g;
+	
+	for (g = 0; g < capture->count; g++) {
+		if (capture->frames[g].frame == frame) return 1;
+	}
+	
+	return 0;
+}
+
+int golden_capture_frame (GoldenCapture *capture, int frame, SDL_Surface *surface) {
+	GoldenFrame *f = NULL;
+	Uint64 hash;
+	char name[32], *filename;
+	int g;
+	
+	for (g = 0; g < capture->count; g++) {
+		if (capture->frames[g].frame == frame) f = &capture->frames[g];
+	}
+	if (f == NULL) return -1;
+	
+	if (capture->copy == NULL || capture->copy->w != surface->w || capture->copy->h != surface->h) {
+		if (capture->copy != NULL) SDL_FreeSurface (capture->copy);
+		capture->copy = SDL_CreateRGBSurface (SDL_SWSURFACE, surface->w, surface->h, 24, GOLDEN_RMASK, GOLDEN_GMASK, GOLDEN_BMASK, 0);
+		if (capture->copy == NULL) return -1;
+	}
+	
+	SDL_BlitSurface (surface, NULL, capture->copy, NULL);
+	
+	/* Sólo los pixeles, sin el relleno al final de cada renglón */
+	hash = SURFACE_CACHE_HASH_INIT;
+	for (g = 0; g < capture->copy->h; g++) {
+		hash = surface_cache_hash (hash, (Uint8 *) capture->copy->pixels + g * capture->copy->pitch, capture->copy->w * 3);
+	}
+	
+	f->hash = hash;
+	f->captured = 1;
+	
+#ifdef HAVE_LIBPNG
+	if (capture->out_dir != NULL) {
+		snprintf (name, sizeof (name), "frame-%05i.png", frame);
+		filename = golden_path (capture->out_dir, name);
+		if (filename != NULL && SDL_SavePNG (capture->copy, filename) < 0) {
+			fprintf (stderr, _("Golden frames: can't write %s\n"), filename);
+		}
+		free (filename);
+	}
+#else
+	(void) name;
+	(void) filename;
+#endif
+	
+	return 0;
+}
+
+/* Escribe frames.txt, reporta la comparación y regresa cuántos cuadros
+ * fallaron contra la referencia, o 1 si no se pudo leer */
+int golden_capture_finish (GoldenCapture *capture, FILE *f) {
+	GoldenFrame *frame;
+	char *filename = NULL;
+	FILE *manifest = NULL;
+	int g, mismatches = 0, compared = 0, failed = 0;
+	
+	if (capture->out_dir != NULL) {
+		filename = golden_path (capture->out_dir, "frames.txt");
+		if (filename != NULL) manifest = fopen (filename, "w");
+		if (manifest == NULL) fprintf (stderr, _("Golden frames: can't write %s\n"), filename != NULL ? filename : capture->out_dir);
+		free (filename);
+	}
+	
+	fprintf (f, "\nGolden frames\n");
+	for (g = 0; g < capture->count; g++) {
+		frame = &capture->frames[g];
+		
+		if (!frame->captured) {
+			fprintf (f, "%8i %16s  not drawn\n", frame->frame, "");
+			failed++;
+			continue;
+		}
+		
+		if (manifest != NULL) fprintf (manifest, "%i %016llx\n", frame->frame, (unsigned long long) frame->hash);
+		
+		fprintf (f, "%8i %016llx", frame->frame, (unsigned long long) frame->hash);
+		if (!frame->has_golden) {
+			fprintf (f, "  no golden\n");
+			failed++;
+		} else if (frame->golden == frame->hash) {
+			fprintf (f, "  ok\n");
+			compared++;
+		} else {
+			fprintf (f, "  MISMATCH, golden %016llx\n", (unsigned long long) frame->golden);
+			compared++;
+			mismatches++;
+		}
+	}
+	
+	if (manifest != NULL) fclose (manifest);
+	
+	if (compared > 0) {
+		fprintf (f, "%i of %i frames match the golden frames\n", compared - mismatches, compared);
+	}
+	
+	/* Sin referencia sólo se capturó, no hay nada que pueda fallar */
+	if (!capture->has_golden_dir) return 0;
+	
+	if (capture->golden_failed) {
+		fprintf (f, "The golden frames could not be read\n");
+		return (mismatches + failed > 0) ? mismatches + failed : 1;
+	}
+	
+	if (failed > 0) {
+		fprintf (f, "%i frames could not be compared\n", failed);
+	}
+	
+	return mismatches + failed;
+}
+
+/* Los tiempos de la corrida se guardan junto a los cuadros */
+FILE * golden_capture_timings (GoldenCapture *capture) {
+	char *filename;
+	FILE *f;
+	
+	if (capture->out_dir == NULL) return NULL;
+	
+	filename = golden_path (capture->out_dir, "timings.txt");
+	if (filename == NULL) return NULL;
+	
+	f = fopen (filename, "w");
+	if (f == NULL) fprintf (stderr, _("Golden frames: can't write %s\n"), filename);
+	free (filename);
+	
+	return f;
+}
+
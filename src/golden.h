@@ -0,0 +1,44 @@
+/*
+ * golden.h
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef __GOLDEN_H__
+#define __GOLDEN_H__
+
+#include <stdio.h>
+
+#include <SDL.h>
+
+/* Cuadros que se pueden capturar en una corrida */
+#define GOLDEN_MAX_FRAMES 64
+
+typedef struct _GoldenCapture GoldenCapture;
+
+GoldenCapture * golden_capture_new (const char *frames, const char *out_dir, const char *golden_dir);
+void golden_capture_free (GoldenCapture *capture);
+int golden_capture_last (GoldenCapture *capture);
+int golden_capture_wants (GoldenCapture *capture, int frame);
+int golden_capture_frame (GoldenCapture *capture, int frame, SDL_Surface *surface);
+int golden_capture_finish (GoldenCapture *capture, FILE *f);
+FILE * golden_capture_timings (GoldenCapture *capture);
+
+#endif /* __GOLDEN_H__ */
+
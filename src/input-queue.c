@@ -0,0 +1,158 @@
+/*
+ * input-queue.c
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <stdlib.h>
+
+#include <SDL.h>
+#include <SDL_thread.h>
+
+#include "input-queue.h"
+#include "timing.h"
+
+/*
+ * Eventos del hilo principal para el hilo de la simulación.
+ *
+ * SDL sólo entrega eventos al hilo que abrió la ventana, así que ese hilo
+ * los pasa por esta cola junto con la última posición del ratón. Si la
+ * cola se llena, se pierde el movimiento del ratón más viejo, que de todos
+ * modos ya lo reemplazó la posición más reciente. Sin movimientos en la
+ * cola, los eventos nuevos se pierden, salvo SDL_QUIT, que saca al más viejo.
+ *
+ * Los eventos de SDL 1.2 no traen la hora, así que cada evento y cada
+ * posición del ratón se marcan con timing_now_us al entrar a la cola.
+ */
+
+struct _InputQueue {
+	SDL_mutex *lock;
+	SDL_Event events[INPUT_QUEUE_SIZE];
+	Uint64 times[INPUT_QUEUE_SIZE];
+	int first, count;
+	int mouse_x, mouse_y;
+	Uint64 mouse_time;
+};
+
+InputQueue * input_queue_new (void) {
+	InputQueue *queue;
+	
+	queue = (InputQueue *) malloc (sizeof (InputQueue));
+	if (queue == NULL) return NULL;
+	
+	queue->lock = SDL_CreateMutex ();
+	if (queue->lock == NULL) {
+		free (queue);
+		return NULL;
+	}
+	
+	queue->first = queue->count = 0;
+	queue->mouse_x = queue->mouse_y = 0;
+	queue->mouse_time = 0;
+	
+	return queue;
+}
+
+void input_queue_free (InputQueue *queue) {
+	if (queue == NULL) return;
+	
+	SDL_DestroyMutex (queue->lock);
+	free (queue);
+}
+
+/* Hacer espacio en una cola llena, regresa 0 si el evento nuevo se pierde */
+static int input_queue_make_room (InputQueue *queue, SDL_Event *event) {
+	int g, pos, next;
+	
+	for (g = 0; g < queue->count; g++) {
+		pos = (queue->first + g) % INPUT_QUEUE_SIZE;
+		if (queue->events[pos].type != SDL_MOUSEMOTION) continue;
+		
+		/* Recorrer los que siguen para no cambiar el orden */
+		for (g++; g < queue->count; g++) {
+			next = (queue->first + g) % INPUT_QUEUE_SIZE;
+			queue->events[pos] = queue->events[next];
+			queue->times[pos] = queue->times[next];
+			pos = next;
+		}
+		queue->count--;
+		return 1;
+	}
+	
+	if (event->type == SDL_QUIT) {
+		queue->first = (queue->first + 1) % INPUT_QUEUE_SIZE;
+		queue->count--;
+		return 1;
+	}
+	
+	return 0;
+}
+
+void input_queue_push (InputQueue *queue, SDL_Event *event) {
+	Uint64 now = timing_now_us ();
+	int pos;
+	
+	SDL_LockMutex (queue->lock);
+	
+	if (queue->count < INPUT_QUEUE_SIZE || input_queue_make_room (queue, event)) {
+		pos = (queue->first + queue->count) % INPUT_QUEUE_SIZE;
+		queue->events[pos] = *event;
+		queue->times[pos] = now;
+		queue->count++;
+	}
+	
+	SDL_UnlockMutex (queue->lock);
+}
+
+int input_queue_pop (InputQueue *queue, SDL_Event *event, Uint64 *time) {
+	int got = 0;
+	
+	SDL_LockMutex (queue->lock);
+	
+	if (queue->count > 0) {
+		*event = queue->events[queue->first];
+		if (time != NULL) *time = queue->times[queue->first];
+		queue->first = (queue->first + 1) % INPUT_QUEUE_SIZE;
+		queue->count--;
+		got = 1;
+	}
+	
+	SDL_UnlockMutex (queue->lock);
+	
+	return got;
+}
+
+void input_queue_set_mouse (InputQueue *queue, int x, int y) {
+	Uint64 now = timing_now_us ();
+	
+	SDL_LockMutex (queue->lock);
+	queue->mouse_x = x;
+	queue->mouse_y = y;
+	queue->mouse_time = now;
+	SDL_UnlockMutex (queue->lock);
+}
+
+void input_queue_get_mouse (InputQueue *queue, int *x, int *y, Uint64 *time) {
+	SDL_LockMutex (queue->lock);
+	if (x != NULL) *x = queue->mouse_x;
+	if (y != NULL) *y = queue->mouse_y;
+	if (time != NULL) *time = queue->mouse_time;
+	SDL_UnlockMutex (queue->lock);
+}
+
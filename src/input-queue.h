@@ -0,0 +1,40 @@
+/*
+ * input-queue.h
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef __INPUT_QUEUE_H__
+#define __INPUT_QUEUE_H__
+
+#include <SDL.h>
+
+#define INPUT_QUEUE_SIZE 64
+
+typedef struct _InputQueue InputQueue;
+
+InputQueue * input_queue_new (void);
+void input_queue_free (InputQueue *queue);
+void input_queue_push (InputQueue *queue, SDL_Event *event);
+int input_queue_pop (InputQueue *queue, SDL_Event *event, Uint64 *time);
+void input_queue_set_mouse (InputQueue *queue, int x, int y);
+void input_queue_get_mouse (InputQueue *queue, int *x, int *y, Uint64 *time);
+
+#endif /* __INPUT_QUEUE_H__ */
+
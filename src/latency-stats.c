@@ -0,0 +1,135 @@
+/*
+ * latency-stats.c
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL.h>
+
+#include "latency-stats.h"
+
+/*
+ * Muestras de tiempos por cuadro, en microsegundos, agrupadas en series.
+ *
+ * Se guardan todas las muestras y al final se ordenan para sacar los
+ * percentiles 50, 95 y 99. No tiene candados: cada serie debe llenarse
+ * desde un solo hilo.
+ */
+
+typedef struct {
+	const char *name;
+	Uint32 *samples;
+	int count, max;
+} LatencySeries;
+
+struct _LatencyStats {
+	LatencySeries *series;
+	int n_series;
+};
+
+LatencyStats * latency_stats_new (int n_series, const char **names) {
+	LatencyStats *stats;
+	int g;
+	
+	stats = (LatencyStats *) malloc (sizeof (LatencyStats));
+	if (stats == NULL) return NULL;
+	
+	stats->series = (LatencySeries *) calloc (n_series, sizeof (LatencySeries));
+	if (stats->series == NULL) {
+		free (stats);
+		return NULL;
+	}
+	
+	stats->n_series = n_series;
+	for (g = 0; g < n_series; g++) {
+		stats->series[g].name = names[g];
+	}
+	
+	return stats;
+}
+
+void latency_stats_free (LatencyStats *stats) {
+	int g;
+	
+	if (stats == NULL) return;
+	
+	for (g = 0; g < stats->n_series; g++) {
+		free (stats->series[g].samples);
+	}
+	
+	free (stats->series);
+	free (stats);
+}
+
+void latency_stats_add (LatencyStats *stats, int series, Uint64 us) {
+	LatencySeries *s;
+	Uint32 *bigger;
+	
+	if (series < 0 || series >= stats->n_series) return;
+	s = &stats->series[series];
+	
+	if (s->count == s->max) {
+		bigger = (Uint32 *) realloc (s->samples, (s->max + 1024) * sizeof (Uint32));
+		if (bigger == NULL) return;
+		s->samples = bigger;
+		s->max += 1024;
+	}
+	
+	s->samples[s->count++] = (us > 0xFFFFFFFFU ? 0xFFFFFFFFU : (Uint32) us);
+}
+
+static int latency_stats_compare (const void *a, const void *b) {
+	Uint32 x = *(const Uint32 *) a, y = *(const Uint32 *) b;
+	
+	return (x > y) - (x < y);
+}
+
+/* Percentil por rango más cercano sobre muestras ordenadas */
+static double latency_stats_percentile (Uint32 *sorted, int count, int p) {
+	int rank;
+	
+	rank = (p * count + 99) / 100;
+	if (rank < 1) rank = 1;
+	
+	return sorted[rank - 1] / 1000.0;
+}
+
+void latency_stats_report (LatencyStats *stats, FILE *f) {
+	LatencySeries *s;
+	int g;
+	
+	fprintf (f, "%-24s %8s %9s %9s %9s\n", "Latency (ms)", "samples", "p50", "p95", "p99");
+	
+	for (g = 0; g < stats->n_series; g++) {
+		s = &stats->series[g];
+		if (s->count == 0) continue;
+		
+		qsort (s->samples, s->count, sizeof (Uint32), latency_stats_compare);
+		
+		fprintf (f, "%-24s %8i %9.2f %9.2f %9.2f\n", s->name, s->count,
+			latency_stats_percentile (s->samples, s->count, 50),
+			latency_stats_percentile (s->samples, s->count, 95),
+			latency_stats_percentile (s->samples, s->count, 99));
+	}
+}
+
@@ -0,0 +1,38 @@
+/*
+ * latency-stats.h
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef __LATENCY_STATS_H__
+#define __LATENCY_STATS_H__
+
+#include <stdio.h>
+
+#include <SDL.h>
+
+typedef struct _LatencyStats LatencyStats;
+
+LatencyStats * latency_stats_new (int n_series, const char **names);
+void latency_stats_free (LatencyStats *stats);
+void latency_stats_add (LatencyStats *stats, int series, Uint64 us);
+void latency_stats_report (LatencyStats *stats, FILE *f);
+
+#endif /* __LATENCY_STATS_H__ */
+
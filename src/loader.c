@@ -0,0 +1,216 @@
+/*
+ * loader.c
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <SDL.h>
+#include <SDL_image.h>
+#include <SDL_thread.h>
+
+#include "loader.h"
+#include "workers.h"
+#include "timing.h"
+#include "trace.h"
+
+/*
+ * Decodifica una lista de imágenes en paralelo usando el grupo de hilos.
+ * Cada imagen se escribe en su propio espacio del arreglo de destino, así
+ * que no se necesita sincronizar nada más que el final del lote.
+ */
+
+struct _LoaderBatch {
+	const char *path;
+	const char **names;
+	SDL_Surface **slots;
+	int *items;
+	int *ready;
+	char **errors; /* El error de SDL_image de cada imagen que falló */
+	int count;
+	
+	SDL_mutex *lock;
+	
+	Uint64 *decode_time;
+	Uint64 start;
+	
+	WorkerBatch *work;
+};
+
+/* Totales para el reporte de arranque */
+static int loader_total_images = 0;
+static Uint64 loader_total_decode = 0;
+static Uint64 loader_first_start = 0;
+static Uint64 loader_last_end = 0;
+
+/* El error del último lote que falló. SDL guarda su error por hilo,
+ * así que el del hilo que decodificó se copia aquí */
+static char loader_error[512] = "";
+
+static void loader_decode (void *data, int pos) {
+	LoaderBatch *batch = (LoaderBatch *) data;
+	char buffer_file[8192];
+	Uint64 start;
+	int item;
+	
+	item = batch->items[pos];
+	snprintf (buffer_file, sizeof (buffer_file), "%s%s", batch->path, batch->names[item]);
+	
+	TRACE_BEGIN ("image decode");
+	start = timing_now_us ();
+	batch->slots[item] = IMG_Load (buffer_file);
+	batch->decode_time[pos] = timing_now_us () - start;
+	TRACE_END ("image decode");
+	
+	if (batch->slots[item] == NULL) batch->errors[pos] = strdup (IMG_GetError ());
+	
+	SDL_LockMutex (batch->lock);
+	batch->ready[pos] = 1;
+	SDL_UnlockMutex (batch->lock);
+}
+
+LoaderBatch * loader_start (const char *path, const char **names, SDL_Surface **slots, int count) {
+	memset (slots, 0, sizeof (SDL_Surface *) * count);
+	
+	return loader_start_items (path, names, slots, NULL, count);
+}
+
+/* Igual que loader_start, pero sólo carga los elementos listados en items.
+ * Los demás espacios del arreglo no se tocan */
+LoaderBatch * loader_start_items (const char *path, const char **names, SDL_Surface **slots, const int *items, int count) {
+	LoaderBatch *batch;
+	static int png_ready = 0;
+	int g;
+	
+	if (!png_ready) {
+		/* IMG_Load inicializa la libpng de forma perezosa, y eso no es seguro
+		 * si varios hilos lo hacen a la vez. Hacerlo aquí, una sola vez */
+		IMG_Init (IMG_INIT_PNG);
+		png_ready = 1;
+	}
+	
+	batch = (LoaderBatch *) malloc (sizeof (LoaderBatch));
+	if (batch == NULL) return NULL;
+	
+	batch->path = path;
+	batch->names = names;
+	batch->slots = slots;
+	batch->count = count;
+	batch->items = (int *) malloc (sizeof (int) * count);
+	batch->ready = (int *) malloc (sizeof (int) * count);
+	batch->errors = (char **) calloc (count, sizeof (char *));
+	batch->decode_time = (Uint64 *) malloc (sizeof (Uint64) * count);
+	batch->lock = SDL_CreateMutex ();
+	
+	for (g = 0; g < count; g++) {
+		batch->items[g] = (items != NULL) ? items[g] : g;
+		slots[batch->items[g]] = NULL;
+	}
+	memset (batch->ready, 0, sizeof (int) * count);
+	memset (batch->decode_time, 0, sizeof (Uint64) * count);
+	
+	batch->start = timing_now_us ();
+	if (loader_first_start == 0) loader_first_start = batch->start;
+	
+	batch->work = workers_batch_start (loader_decode, batch, count);
+	
+	return batch;
+}
+
+int loader_progress (LoaderBatch *batch) {
+	return workers_batch_progress (batch->work);
+}
+
+int loader_count (LoaderBatch *batch) {
+	return batch->count;
+}
+
+/* Revisar si un espacio del arreglo ya tiene su imagen, sin esperar al lote.
+ * Regresa 0 también si el espacio no es parte del lote */
+int loader_slot_ready (LoaderBatch *batch, int slot) {
+	int g, res;
+	
+	res = 0;
+	SDL_LockMutex (batch->lock);
+	for (g = 0; g < batch->count; g++) {
+		if (batch->items[g] == slot) {
+			res = batch->ready[g] && batch->slots[slot] != NULL;
+			break;
+		}
+	}
+	SDL_UnlockMutex (batch->lock);
+	
+	return res;
+}
+
+/* Regresa 0 si todas las imágenes cargaron, -1 y el nombre del primer archivo que falló si no */
+int loader_wait (LoaderBatch *batch, char *failed_file, int size) {
+	int g, res;
+	Uint64 end;
+	
+	workers_batch_wait (batch->work);
+	end = timing_now_us ();
+	
+	res = 0;
+	for (g = 0; g < batch->count; g++) {
+		loader_total_decode += batch->decode_time[g];
+		
+		if (batch->slots[batch->items[g]] == NULL && res == 0) {
+			snprintf (failed_file, size, "%s%s", batch->path, batch->names[batch->items[g]]);
+			snprintf (loader_error, sizeof (loader_error), "%s", batch->errors[g] != NULL ? batch->errors[g] : "");
+			res = -1;
+		}
+		free (batch->errors[g]);
+	}
+	
+	loader_total_images += batch->count;
+	if (end > loader_last_end) loader_last_end = end;
+	
+	SDL_DestroyMutex (batch->lock);
+	free (batch->items);
+	free (batch->ready);
+	free (batch->errors);
+	free (batch->decode_time);
+	free (batch);
+	
+	return res;
+}
+
+/* El error de SDL_image de la imagen que hizo fallar el último loader_wait */
+const char * loader_get_error (void) {
+	return loader_error;
+}
+
+void loader_report (void) {
+	Uint64 wall;
+	
+	if (loader_total_images == 0) return;
+	
+	/* Los lotes pueden traslaparse, el tiempo real es del primero al último */
+	wall = loader_last_end - loader_first_start;
+	
+	printf ("Startup: %i images decoded on %i threads in %u ms (sum of decode times: %u ms, %.1fx)\n",
+		loader_total_images, workers_count (),
+		(unsigned int) (wall / 1000), (unsigned int) (loader_total_decode / 1000),
+		wall > 0 ? (double) loader_total_decode / (double) wall : 0.0);
+}
+
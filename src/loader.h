@@ -0,0 +1,40 @@
+/*
+ * loader.h
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef __LOADER_H__
+#define __LOADER_H__
+
+#include <SDL.h>
+
+typedef struct _LoaderBatch LoaderBatch;
+
+LoaderBatch * loader_start (const char *path, const char **names, SDL_Surface **slots, int count);
+LoaderBatch * loader_start_items (const char *path, const char **names, SDL_Surface **slots, const int *items, int count);
+int loader_progress (LoaderBatch *batch);
+int loader_count (LoaderBatch *batch);
+int loader_slot_ready (LoaderBatch *batch, int slot);
+int loader_wait (LoaderBatch *batch, char *failed_file, int size);
+const char * loader_get_error (void);
+void loader_report (void);
+
+#endif /* __LOADER_H__ */
+
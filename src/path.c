@@ -44,6 +44,8 @@
 static char *systemdata_path;
 static char *l10n_path;
 static char *userdata_path;
+static char *cache_path;
+static char *log_path;
 
 //#ifdef __MINGW32__
 //const char *PathSeparator = "\\";      // for path assembly
@@ -285,6 +287,26 @@ void initSystemPaths (const char *argv_0) {
 		userdata_path = NULL;
 	}
 	
+	/* Las cachés y los registros van en carpetas propias dentro del user path */
+	if (userdata_path != NULL) {
+		cache_path = (char *) malloc (strlen (userdata_path) + 40);
+#if defined (MACOSX) || defined (__MINGW32__)
+		sprintf (cache_path, "%s/BeanCountersClassic/cache/", userdata_path);
+#else
+		sprintf (cache_path, "%s/.bean-counters-classic/cache/", userdata_path);
+#endif
+		
+		log_path = (char *) malloc (strlen (userdata_path) + 40);
+#if defined (MACOSX) || defined (__MINGW32__)
+		sprintf (log_path, "%s/BeanCountersClassic/logs/", userdata_path);
+#else
+		sprintf (log_path, "%s/.bean-counters-classic/logs/", userdata_path);
+#endif
+	} else {
+		cache_path = NULL;
+		log_path = NULL;
+	}
+	
 	/* Liberar las cadenas temporales */
 	free (progdir);
 	free (progCallPath);
@@ -302,4 +324,11 @@ char *get_userdata_path (void) {
 	return userdata_path;
 }
 
+char *get_cache_path (void) {
+	return cache_path;
+}
+
+char *get_log_path (void) {
+	return log_path;
+}
 
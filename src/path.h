@@ -24,6 +24,8 @@
 char *get_systemdata_path (void);
 char *get_l10n_path (void);
 char *get_userdata_path (void);
+char *get_cache_path (void);
+char *get_log_path (void);
 
 void initSystemPaths (const char *argv_0);
 int folder_exists (const char *fname);
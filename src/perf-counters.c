@@ -0,0 +1,274 @@
+/*
+ * perf-counters.c
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include "perf-counters.h"
+
+#ifdef ENABLE_PERF_COUNTERS
+
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include <SDL.h>
+
+/*
+ * Contadores del procesador por región, con perf_event_open.
+ *
+ * Cada hilo abre su propio grupo de contadores la primera vez que entra a
+ * una región, porque los contadores sólo miden al hilo que los abrió. Al
+ * entrar se leen todos los contadores del grupo de una vez, y al salir la
+ * diferencia se suma a los totales de la región.
+ *
+ * Las regiones anidadas se cuentan en ambas. Si una región reparte trabajo
+ * a los hilos, sólo cuenta la parte del hilo que entró. El blitter de gfx
+ * se mide en cada llamada, con y sin alfa general, así que incluye los
+ * mosaicos del compositor y los desvanecidos aunque corran en los hilos.
+ *
+ * No todos los hilos tienen por fuerza los mismos contadores, así que cada
+ * proporción se calcula sólo con las llamadas que tenían ambos contadores.
+ * Los descriptores de todos los hilos se cierran en perf_counters_close.
+ */
+
+/* Descriptores abiertos entre todos los hilos */
+#define PERF_MAX_FDS 256
+
+enum {
+	PERF_CYCLES = 0,
+	PERF_INSTRUCTIONS,
+	PERF_CACHE_MISSES,
+	PERF_BRANCH_MISSES,
+	
+	NUM_PERF_COUNTERS
+};
+
+static const Uint64 perf_configs[NUM_PERF_COUNTERS] = {
+	PERF_COUNT_HW_CPU_CYCLES,
+	PERF_COUNT_HW_INSTRUCTIONS,
+	PERF_COUNT_HW_CACHE_MISSES,
+	PERF_COUNT_HW_BRANCH_MISSES
+};
+
+static const char *perf_region_names[NUM_PERF_REGIONS] = {
+	"collisions",
+	"blits",
+	"gfx blitter",
+	"zoom RGBA"
+};
+
+int perf_counters_enabled = 0;
+
+static Uint64 perf_totals[NUM_PERF_REGIONS][NUM_PERF_COUNTERS];
+static Uint64 perf_calls[NUM_PERF_REGIONS];
+
+/* La base de cada proporción, sumada sólo cuando ambos contadores se
+ * leyeron: ciclos para las instrucciones, instrucciones para los fallos */
+static Uint64 perf_base[NUM_PERF_REGIONS][NUM_PERF_COUNTERS];
+
+static SDL_mutex *perf_lock = NULL;
+static int perf_fds[PERF_MAX_FDS];
+static int perf_n_fds = 0;
+
+/* El grupo de este hilo: -2 sin abrir, -1 si falló */
+static __thread int perf_group = -2;
+static __thread int perf_slot[NUM_PERF_COUNTERS];
+static __thread int perf_n_slots;
+static __thread Uint64 perf_start[NUM_PERF_REGIONS][NUM_PERF_COUNTERS];
+
+static int perf_open (Uint64 config, int group) {
+	struct perf_event_attr attr;
+	int fd;
+	
+	memset (&attr, 0, sizeof (attr));
+	attr.size = sizeof (attr);
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.config = config;
+	attr.disabled = (group == -1);
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_GROUP;
+	
+	fd = (int) syscall (__NR_perf_event_open, &attr, 0, -1, group, 0);
+	if (fd < 0) return -1;
+	
+	/* Anotarlo para cerrarlo al final; sin espacio no se usa */
+	SDL_LockMutex (perf_lock);
+	if (perf_n_fds < PERF_MAX_FDS) {
+		perf_fds[perf_n_fds++] = fd;
+	} else {
+		close (fd);
+		fd = -1;
+	}
+	SDL_UnlockMutex (perf_lock);
+	
+	return fd;
+}
+
+static int perf_open_group (void) {
+	int g, fd;
+	
+	perf_n_slots = 0;
+	
+	/* Los ciclos son el líder, sin ellos no hay grupo */
+	perf_group = perf_open (perf_configs[PERF_CYCLES], -1);
+	if (perf_group < 0) {
+		perf_group = -1;
+		return -1;
+	}
+	perf_slot[PERF_CYCLES] = perf_n_slots++;
+	
+	/* Algunas máquinas virtuales no tienen todos los contadores */
+	for (g = PERF_CYCLES + 1; g < NUM_PERF_COUNTERS; g++) {
+		fd = perf_open (perf_configs[g], perf_group);
+		if (fd < 0) {
+			perf_slot[g] = -1;
+		} else {
+			perf_slot[g] = perf_n_slots++;
+		}
+	}
+	
+	ioctl (perf_group, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl (perf_group, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	
+	return 0;
+}
+
+static int perf_read (Uint64 *values) {
+	Uint64 buffer[1 + NUM_PERF_COUNTERS];
+	int g;
+	
+	if (perf_group == -2) perf_open_group ();
+	if (perf_group < 0 || !perf_counters_enabled) return -1;
+	
+	if (read (perf_group, buffer, sizeof (Uint64) * (1 + perf_n_slots)) < (ssize_t) (sizeof (Uint64) * (1 + perf_n_slots))) return -1;
+	
+	/* Lo que este hilo no pudo abrir queda en 0 */
+	for (g = 0; g < NUM_PERF_COUNTERS; g++) {
+		values[g] = (perf_slot[g] < 0) ? 0 : buffer[1 + perf_slot[g]];
+	}
+	
+	return 0;
+}
+
+int perf_counters_init (void) {
+	if (perf_lock == NULL) perf_lock = SDL_CreateMutex ();
+	if (perf_lock == NULL) return -1;
+	
+	memset (perf_totals, 0, sizeof (perf_totals));
+	memset (perf_base, 0, sizeof (perf_base));
+	memset (perf_calls, 0, sizeof (perf_calls));
+	
+	/* Probar en este hilo, los demás abren el suyo al entrar a una región */
+	if (perf_open_group () < 0) {
+		fprintf (stderr, "perf_event_open failed: %s (check /proc/sys/kernel/perf_event_paranoid)\n", strerror (errno));
+		return -1;
+	}
+	
+	perf_counters_enabled = 1;
+	
+	return 0;
+}
+
+void perf_counters_begin (int region) {
+	if (perf_read (perf_start[region]) < 0) perf_start[region][PERF_CYCLES] = 0;
+}
+
+void perf_counters_end (int region) {
+	Uint64 now[NUM_PERF_COUNTERS];
+	int g;
+	
+	if (perf_start[region][PERF_CYCLES] == 0 || perf_read (now) < 0) return;
+	
+	for (g = 0; g < NUM_PERF_COUNTERS; g++) {
+		now[g] -= perf_start[region][g];
+		__atomic_fetch_add (&perf_totals[region][g], now[g], __ATOMIC_RELAXED);
+	}
+	
+	if (perf_slot[PERF_INSTRUCTIONS] >= 0) {
+		__atomic_fetch_add (&perf_base[region][PERF_INSTRUCTIONS], now[PERF_CYCLES], __ATOMIC_RELAXED);
+		
+		for (g = PERF_INSTRUCTIONS + 1; g < NUM_PERF_COUNTERS; g++) {
+			if (perf_slot[g] >= 0) __atomic_fetch_add (&perf_base[region][g], now[PERF_INSTRUCTIONS], __ATOMIC_RELAXED);
+		}
+	}
+	__atomic_fetch_add (&perf_calls[region], 1, __ATOMIC_RELAXED);
+}
+
+/* Cerrar los descriptores de todos los hilos. Llamar cuando ya no quede
+ * ningún hilo dentro de una región */
+void perf_counters_close (void) {
+	int g;
+	
+	if (perf_lock == NULL) return;
+	
+	perf_counters_enabled = 0;
+	
+	SDL_LockMutex (perf_lock);
+	for (g = 0; g < perf_n_fds; g++) {
+		close (perf_fds[g]);
+	}
+	perf_n_fds = 0;
+	SDL_UnlockMutex (perf_lock);
+	
+	SDL_DestroyMutex (perf_lock);
+	perf_lock = NULL;
+}
+
+/* Fallos por cada mil instrucciones */
+static void perf_print_rate (FILE *out, Uint64 count, Uint64 instructions) {
+	if (instructions == 0) {
+		fprintf (out, " %12s", "n/a");
+	} else {
+		fprintf (out, " %12.3f", count * 1000.0 / instructions);
+	}
+}
+
+void perf_counters_report (FILE *out) {
+	Uint64 *t, *base;
+	int g;
+	
+	if (!perf_counters_enabled) return;
+	
+	fprintf (out, "%-12s %10s %14s %8s %12s %12s\n", "region", "calls", "cycles", "IPC", "cache MPKI", "branch MPKI");
+	
+	for (g = 0; g < NUM_PERF_REGIONS; g++) {
+		t = perf_totals[g];
+		base = perf_base[g];
+		
+		fprintf (out, "%-12s %10llu %14llu", perf_region_names[g], (unsigned long long) perf_calls[g], (unsigned long long) t[PERF_CYCLES]);
+		if (base[PERF_INSTRUCTIONS] == 0) {
+			fprintf (out, " %8s", "n/a");
+		} else {
+			fprintf (out, " %8.2f", (double) t[PERF_INSTRUCTIONS] / base[PERF_INSTRUCTIONS]);
+		}
+		perf_print_rate (out, t[PERF_CACHE_MISSES], base[PERF_CACHE_MISSES]);
+		perf_print_rate (out, t[PERF_BRANCH_MISSES], base[PERF_BRANCH_MISSES]);
+		fprintf (out, "\n");
+	}
+}
+
+#endif /* ENABLE_PERF_COUNTERS */
+
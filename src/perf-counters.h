@@ -0,0 +1,59 @@
+/*
+ * perf-counters.h
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef __PERF_COUNTERS_H__
+#define __PERF_COUNTERS_H__
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+
+enum {
+	PERF_REGION_COLLISIONS = 0,
+	PERF_REGION_BLITS,
+	PERF_REGION_GFX_BLIT,
+	PERF_REGION_ZOOM,
+	
+	NUM_PERF_REGIONS
+};
+
+#ifdef ENABLE_PERF_COUNTERS
+extern int perf_counters_enabled;
+
+int perf_counters_init (void);
+void perf_counters_begin (int region);
+void perf_counters_end (int region);
+void perf_counters_report (FILE *out);
+void perf_counters_close (void);
+
+#define PERF_BEGIN(region) do { if (perf_counters_enabled) perf_counters_begin (region); } while (0)
+#define PERF_END(region) do { if (perf_counters_enabled) perf_counters_end (region); } while (0)
+#else
+/* Sin --enable-perf-counters no queda nada en el código */
+#define PERF_BEGIN(region) do { } while (0)
+#define PERF_END(region) do { } while (0)
+#endif
+
+#endif /* __PERF_COUNTERS_H__ */
+
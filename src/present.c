@@ -0,0 +1,254 @@
+/*
+ * present.c
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <SDL.h>
+
+#include "present.h"
+#include "scaler.h"
+#include "convert.h"
+#include "trace.h"
+
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+#define RMASK 0xff000000
+#define GMASK 0x00ff0000
+#define BMASK 0x0000ff00
+#else
+#define RMASK 0x000000ff
+#define GMASK 0x0000ff00
+#define BMASK 0x00ff0000
+#endif
+
+/*
+ * Mostrar la pantalla del juego en una ventana más grande.
+ *
+ * El juego siempre dibuja a su tamaño original. Con escala 1 esa superficie
+ * es la ventana, como siempre. Con escala 2, 3 o 4 se dibuja en una
+ * superficie aparte del mismo formato y al actualizar se amplía a la
+ * ventana real, sólo en los rectángulos que cambiaron. Las coordenadas del
+ * ratón se regresan al tamaño del juego.
+ *
+ * Con PRESENT_COMPOSE_32 y una ventana de 16 bits, el juego dibuja en una
+ * superficie de 32 bits con el mismo orden de bytes que las imágenes, así
+ * que las mezclas no convierten formatos. Al actualizar se hace una sola
+ * conversión a 16 bits (con PRESENT_DITHER, con dither ordenado) y, si hay
+ * escala, se amplía el resultado.
+ */
+
+static SDL_Surface *present_window = NULL;
+static SDL_Surface *present_screen = NULL;
+static SDL_Surface *present_native = NULL;
+static int present_scale = 1;
+static int present_filter = SCALER_NEAREST;
+static int present_convert = 0;
+static int present_dither = 0;
+
+/* El factor entero más grande que cabe en el escritorio actual */
+int present_auto_scale (int width, int height) {
+	const SDL_VideoInfo *info;
+	int scale;
+	
+	info = SDL_GetVideoInfo ();
+	if (info == NULL || info->current_w <= 0 || info->current_h <= 0) return 1;
+	
+	scale = info->current_w / width;
+	if (info->current_h / height < scale) scale = info->current_h / height;
+	
+	if (scale < 1) scale = 1;
+	if (scale > PRESENT_MAX_SCALE) scale = PRESENT_MAX_SCALE;
+	
+	return scale;
+}
+
+static void present_free_buffers (void) {
+	if (present_screen != NULL && present_screen != present_window) {
+		SDL_FreeSurface (present_screen);
+	}
+	if (present_native != NULL) {
+		SDL_FreeSurface (present_native);
+	}
+	
+	present_screen = NULL;
+	present_native = NULL;
+}
+
+SDL_Surface * present_set_video_mode (int width, int height, int scale, int filter, int options, Uint32 flags) {
+	/* Prefer 16bpp, but also prefer native modes to emulated 16bpp. */
+	SDL_PixelFormat *fmt;
+	int depth;
+	
+	if (scale < 1) scale = 1;
+	if (scale > PRESENT_MAX_SCALE) scale = PRESENT_MAX_SCALE;
+	
+	depth = SDL_VideoModeOK (width * scale, height * scale, 16, flags);
+	if (depth == 0 && scale > 1) {
+		/* No hay ventana tan grande, usar el tamaño original */
+		scale = 1;
+		depth = SDL_VideoModeOK (width, height, 16, flags);
+	}
+	if (depth == 0) return NULL;
+	
+	present_free_buffers ();
+	present_window = SDL_SetVideoMode (width * scale, height * scale, depth, flags);
+	if (present_window == NULL) return NULL;
+	
+	/* El escalador sólo trabaja con 16 o 32 bits */
+	if (present_window->format->BytesPerPixel != 2 && present_window->format->BytesPerPixel != 4) {
+		if (scale > 1) {
+			return present_set_video_mode (width, height, 1, filter, options, flags);
+		}
+	}
+	
+	present_scale = scale;
+	present_filter = filter;
+	present_convert = ((options & PRESENT_COMPOSE_32) && present_window->format->BytesPerPixel == 2);
+	present_dither = ((options & PRESENT_DITHER) != 0);
+	fmt = present_window->format;
+	
+	if (present_convert) {
+		present_screen = SDL_CreateRGBSurface (SDL_SWSURFACE, width, height, 32, RMASK, GMASK, BMASK, 0);
+		if (present_screen != NULL && scale > 1) {
+			/* La conversión a 16 bits se hace antes de ampliar */
+			present_native = SDL_CreateRGBSurface (SDL_SWSURFACE, width, height, fmt->BitsPerPixel, fmt->Rmask, fmt->Gmask, fmt->Bmask, fmt->Amask);
+			if (present_native == NULL) {
+				present_free_buffers ();
+			}
+		}
+	} else if (scale == 1) {
+		present_screen = present_window;
+	} else {
+		present_screen = SDL_CreateRGBSurface (SDL_SWSURFACE, width, height, fmt->BitsPerPixel, fmt->Rmask, fmt->Gmask, fmt->Bmask, fmt->Amask);
+	}
+	
+	return present_screen;
+}
+
+int present_get_scale (void) {
+	return present_scale;
+}
+
+/* Pasar un rectángulo (o todo, con NULL) del juego a la ventana */
+static void present_blit (SDL_Rect *rect) {
+	TRACE_BEGIN ("present blit");
+	if (SDL_MUSTLOCK (present_window)) SDL_LockSurface (present_window);
+	
+	if (present_convert && present_scale == 1) {
+		convert_32_to_16 (present_screen, rect, present_window, present_dither);
+	} else if (present_convert) {
+		convert_32_to_16 (present_screen, rect, present_native, present_dither);
+		scaler_blit (present_native, rect, present_window, present_scale, present_filter);
+	} else {
+		scaler_blit (present_screen, rect, present_window, present_scale, present_filter);
+	}
+	
+	if (SDL_MUSTLOCK (present_window)) SDL_UnlockSurface (present_window);
+	TRACE_END ("present blit");
+}
+
+void present_update_rects (int numrects, SDL_Rect *rects) {
+	SDL_Rect scaled;
+	int g;
+	
+	if (present_screen == present_window) {
+		SDL_UpdateRects (present_window, numrects, rects);
+		return;
+	}
+	
+	for (g = 0; g < numrects; g++) {
+		present_blit (&rects[g]);
+	}
+	
+	for (g = 0; g < numrects; g++) {
+		scaled.x = rects[g].x * present_scale;
+		scaled.y = rects[g].y * present_scale;
+		scaled.w = rects[g].w * present_scale;
+		scaled.h = rects[g].h * present_scale;
+		
+		SDL_UpdateRects (present_window, 1, &scaled);
+	}
+}
+
+void present_update_rect (Sint32 x, Sint32 y, Uint32 w, Uint32 h) {
+	SDL_Rect rect;
+	
+	if (x == 0 && y == 0 && w == 0 && h == 0) {
+		/* Igual que SDL_UpdateRect, todo en ceros es la pantalla completa */
+		w = present_screen->w;
+		h = present_screen->h;
+	}
+	
+	rect.x = x;
+	rect.y = y;
+	rect.w = w;
+	rect.h = h;
+	
+	present_update_rects (1, &rect);
+}
+
+void present_flip (void) {
+	if (present_screen != present_window) {
+		present_blit (NULL);
+	}
+	
+	SDL_Flip (present_window);
+}
+
+void present_toggle_fullscreen (void) {
+	SDL_WM_ToggleFullScreen (present_window);
+}
+
+static void present_map_point (Uint16 *x, Uint16 *y) {
+	*x = *x / present_scale;
+	*y = *y / present_scale;
+}
+
+int present_poll_event (SDL_Event *event) {
+	int r;
+	
+	r = SDL_PollEvent (event);
+	
+	if (r > 0 && present_scale > 1) {
+		switch (event->type) {
+			case SDL_MOUSEMOTION:
+				present_map_point (&event->motion.x, &event->motion.y);
+				event->motion.xrel /= present_scale;
+				event->motion.yrel /= present_scale;
+				break;
+			case SDL_MOUSEBUTTONDOWN:
+			case SDL_MOUSEBUTTONUP:
+				present_map_point (&event->button.x, &event->button.y);
+				break;
+		}
+	}
+	
+	return r;
+}
+
+Uint8 present_get_mouse_state (int *x, int *y) {
+	Uint8 buttons;
+	
+	buttons = SDL_GetMouseState (x, y);
+	if (x != NULL) *x = *x / present_scale;
+	if (y != NULL) *y = *y / present_scale;
+	
+	return buttons;
+}
+
@@ -0,0 +1,45 @@
+/*
+ * present.h
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef __PRESENT_H__
+#define __PRESENT_H__
+
+#include <SDL.h>
+
+#define PRESENT_MAX_SCALE 4
+
+/* Opciones de present_set_video_mode */
+#define PRESENT_COMPOSE_32 0x01
+#define PRESENT_DITHER 0x02
+
+int present_auto_scale (int width, int height);
+SDL_Surface * present_set_video_mode (int width, int height, int scale, int filter, int options, Uint32 flags);
+int present_get_scale (void);
+void present_flip (void);
+void present_update_rects (int numrects, SDL_Rect *rects);
+void present_update_rect (Sint32 x, Sint32 y, Uint32 w, Uint32 h);
+void present_toggle_fullscreen (void);
+int present_poll_event (SDL_Event *event);
+Uint8 present_get_mouse_state (int *x, int *y);
+
+#endif /* __PRESENT_H__ */
+
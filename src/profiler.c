@@ -0,0 +1,242 @@
+/*
+ * profiler.c
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <SDL.h>
+#include <SDL_thread.h>
+
+#include "profiler.h"
+
+#ifdef ENABLE_PROFILER
+
+#include "timing.h"
+
+/*
+ * Tiempos por fase de cada cuadro.
+ *
+ * Cada hilo es una pista: marca el inicio con profiler_start, y cada
+ * profiler_lap suma a la fase el tiempo desde la marca anterior de su pista.
+ * profiler_commit guarda las fases de la pista en un anillo de
+ * PROFILER_HISTORY cuadros y empieza el siguiente. Cada fase pertenece a una
+ * sola pista, así que sólo el anillo necesita candado, para que el overlay
+ * lo lea desde el hilo que dibuja.
+ *
+ * El overlay dibuja con rectángulos y una letra de 3x5, sin depender de
+ * las fuentes del juego.
+ */
+
+#define PROFILER_BUDGET_US (1000000 / 24)
+#define PROFILER_BAR_WIDTH 160
+#define PROFILER_PIXEL 2
+#define PROFILER_ROW (6 * PROFILER_PIXEL)
+
+typedef struct {
+	const char *name;
+	int track;
+	Uint8 r, g, b;
+} ProfilerPhase;
+
+static const ProfilerPhase profiler_phases[NUM_PROFILE_PHASES] = {
+	{"INPUT", PROFILE_TRACK_SIM, 0x60, 0xC0, 0xFF},
+	{"SPAWN", PROFILE_TRACK_SIM, 0xFF, 0xC0, 0x40},
+	{"UPDATE", PROFILE_TRACK_SIM, 0xFF, 0x60, 0x60},
+	{"EMIT", PROFILE_TRACK_SIM, 0xC0, 0x80, 0xFF},
+	{"SLEEP", PROFILE_TRACK_SIM, 0x60, 0x60, 0x60},
+	
+	{"EVENTS", PROFILE_TRACK_DRAW, 0x60, 0xC0, 0xFF},
+	{"CULL", PROFILE_TRACK_DRAW, 0xFF, 0xFF, 0x60},
+	{"BG", PROFILE_TRACK_DRAW, 0x40, 0xE0, 0x80},
+	{"SPRITES", PROFILE_TRACK_DRAW, 0xFF, 0x80, 0x40},
+	{"OVERLAY", PROFILE_TRACK_DRAW, 0xA0, 0xA0, 0xA0},
+	{"PRESENT", PROFILE_TRACK_DRAW, 0xFF, 0x60, 0xC0},
+	{"WAIT", PROFILE_TRACK_DRAW, 0x60, 0x60, 0x60}
+};
+
+/* Letras de 3x5, un renglón por cada 3 bits, de arriba hacia abajo */
+static const Uint16 profiler_digits[10] = {
+	0x7B6F, 0x2C97, 0x73E7, 0x73CF, 0x5BC9, 0x79CF, 0x79EF, 0x7249, 0x7BEF, 0x7BCF
+};
+
+static const Uint16 profiler_letters[26] = {
+	0x2BED, 0x6BAE, 0x3923, 0x6B6E, 0x79A7, 0x79A4, 0x396B, 0x5BED, 0x7497, 0x126A,
+	0x5BAD, 0x4927, 0x5FED, 0x6B6D, 0x2B6A, 0x6BA4, 0x2B73, 0x6BAD, 0x388E, 0x7492,
+	0x5B6F, 0x5B6A, 0x5BFD, 0x5AAD, 0x5A92, 0x72A7
+};
+
+static Uint64 profiler_last[NUM_PROFILE_TRACKS];
+static Uint32 profiler_current[NUM_PROFILE_PHASES];
+
+static Uint32 profiler_history[NUM_PROFILE_TRACKS][PROFILER_HISTORY][NUM_PROFILE_PHASES];
+static int profiler_pos[NUM_PROFILE_TRACKS];
+static int profiler_count[NUM_PROFILE_TRACKS];
+static SDL_mutex *profiler_lock = NULL;
+
+static int profiler_visible = 0;
+
+void profiler_init (void) {
+	if (profiler_lock == NULL) profiler_lock = SDL_CreateMutex ();
+}
+
+void profiler_start (int track) {
+	profiler_last[track] = timing_now_us ();
+}
+
+void profiler_lap (int phase) {
+	int track = profiler_phases[phase].track;
+	Uint64 now = timing_now_us ();
+	
+	profiler_current[phase] += (Uint32) (now - profiler_last[track]);
+	profiler_last[track] = now;
+}
+
+void profiler_commit (int track) {
+	Uint32 *row;
+	int g;
+	
+	if (profiler_lock != NULL) SDL_LockMutex (profiler_lock);
+	
+	row = profiler_history[track][profiler_pos[track]];
+	for (g = 0; g < NUM_PROFILE_PHASES; g++) {
+		if (profiler_phases[g].track != track) continue;
+		
+		row[g] = profiler_current[g];
+		profiler_current[g] = 0;
+	}
+	
+	profiler_pos[track] = (profiler_pos[track] + 1) % PROFILER_HISTORY;
+	if (profiler_count[track] < PROFILER_HISTORY) profiler_count[track]++;
+	
+	if (profiler_lock != NULL) SDL_UnlockMutex (profiler_lock);
+}
+
+void profiler_toggle (void) {
+	profiler_visible = !profiler_visible;
+}
+
+static void profiler_fill (SDL_Surface *dst, int x, int y, int w, int h, Uint32 color) {
+	SDL_Rect rect;
+	
+	rect.x = x;
+	rect.y = y;
+	rect.w = w;
+	rect.h = h;
+	
+	SDL_FillRect (dst, &rect, color);
+}
+
+static void profiler_text (SDL_Surface *dst, int x, int y, const char *text, Uint32 color) {
+	Uint16 glyph;
+	int row, col;
+	
+	for (; *text != 0; text++, x += 4 * PROFILER_PIXEL) {
+		if (*text >= '0' && *text <= '9') {
+			glyph = profiler_digits[*text - '0'];
+		} else if (*text >= 'A' && *text <= 'Z') {
+			glyph = profiler_letters[*text - 'A'];
+		} else if (*text == '.') {
+			profiler_fill (dst, x + PROFILER_PIXEL, y + 4 * PROFILER_PIXEL, PROFILER_PIXEL, PROFILER_PIXEL, color);
+			continue;
+		} else {
+			continue;
+		}
+		
+		for (row = 0; row < 5; row++) {
+			for (col = 0; col < 3; col++) {
+				if (glyph & (1 << ((4 - row) * 3 + (2 - col)))) {
+					profiler_fill (dst, x + col * PROFILER_PIXEL, y + row * PROFILER_PIXEL, PROFILER_PIXEL, PROFILER_PIXEL, color);
+				}
+			}
+		}
+	}
+}
+
+/* Dibuja el overlay en la esquina inferior izquierda, en area queda lo que
+ * se dibujó. Devuelve 0 si está oculto */
+int profiler_draw_overlay (SDL_Surface *dst, SDL_Rect *area) {
+	Uint32 sum[NUM_PROFILE_PHASES], peak[NUM_PROFILE_PHASES];
+	int count[NUM_PROFILE_TRACKS];
+	Uint32 avg, v;
+	char number[16];
+	int g, h, t, x, y, w;
+	
+	if (!profiler_visible) return 0;
+	
+	memset (sum, 0, sizeof (sum));
+	memset (peak, 0, sizeof (peak));
+	
+	if (profiler_lock != NULL) SDL_LockMutex (profiler_lock);
+	for (t = 0; t < NUM_PROFILE_TRACKS; t++) {
+		count[t] = profiler_count[t];
+		for (h = 0; h < profiler_count[t]; h++) {
+			for (g = 0; g < NUM_PROFILE_PHASES; g++) {
+				if (profiler_phases[g].track != t) continue;
+				
+				v = profiler_history[t][h][g];
+				sum[g] += v;
+				if (v > peak[g]) peak[g] = v;
+			}
+		}
+	}
+	if (profiler_lock != NULL) SDL_UnlockMutex (profiler_lock);
+	
+	area->w = 8 * 4 * PROFILER_PIXEL + PROFILER_BAR_WIDTH + 6 * 4 * PROFILER_PIXEL + 12;
+	area->h = (NUM_PROFILE_PHASES + 1) * PROFILER_ROW + 8;
+	area->x = 4;
+	area->y = dst->h - area->h - 4;
+	
+	profiler_fill (dst, area->x, area->y, area->w, area->h, SDL_MapRGB (dst->format, 0, 0, 0));
+	
+	x = area->x + 4;
+	y = area->y + 4;
+	for (g = 0; g < NUM_PROFILE_PHASES; g++) {
+		/* Una línea vacía entre las pistas */
+		if (g > 0 && profiler_phases[g].track != profiler_phases[g - 1].track) y += PROFILER_ROW;
+		
+		t = profiler_phases[g].track;
+		avg = (count[t] > 0 ? sum[g] / count[t] : 0);
+		
+		profiler_text (dst, x, y, profiler_phases[g].name, SDL_MapRGB (dst->format, 0xFF, 0xFF, 0xFF));
+		
+		/* Barra del promedio y una marca en el máximo, la barra completa
+		 * es un paso de la simulación */
+		w = (int) (((Uint64) avg * PROFILER_BAR_WIDTH) / PROFILER_BUDGET_US);
+		if (w > PROFILER_BAR_WIDTH) w = PROFILER_BAR_WIDTH;
+		profiler_fill (dst, x + 8 * 4 * PROFILER_PIXEL, y, PROFILER_BAR_WIDTH, 5 * PROFILER_PIXEL, SDL_MapRGB (dst->format, 0x30, 0x30, 0x30));
+		if (w > 0) profiler_fill (dst, x + 8 * 4 * PROFILER_PIXEL, y, w, 5 * PROFILER_PIXEL, SDL_MapRGB (dst->format, profiler_phases[g].r, profiler_phases[g].g, profiler_phases[g].b));
+		
+		w = (int) (((Uint64) peak[g] * PROFILER_BAR_WIDTH) / PROFILER_BUDGET_US);
+		if (w >= PROFILER_BAR_WIDTH) w = PROFILER_BAR_WIDTH - 1;
+		profiler_fill (dst, x + 8 * 4 * PROFILER_PIXEL + w, y, 1, 5 * PROFILER_PIXEL, SDL_MapRGB (dst->format, 0xFF, 0xFF, 0xFF));
+		
+		snprintf (number, sizeof (number), "%u.%02u", avg / 1000, (avg % 1000) / 10);
+		profiler_text (dst, x + 8 * 4 * PROFILER_PIXEL + PROFILER_BAR_WIDTH + 8, y, number, SDL_MapRGB (dst->format, 0xFF, 0xFF, 0xFF));
+		
+		y += PROFILER_ROW;
+	}
+	
+	return 1;
+}
+
+#endif /* ENABLE_PROFILER */
+
@@ -0,0 +1,81 @@
+/*
+ * profiler.h
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <SDL.h>
+
+/* Cuadros que guarda cada hilo para el promedio del overlay */
+#define PROFILER_HISTORY 48
+
+enum {
+	PROFILE_TRACK_SIM = 0,
+	PROFILE_TRACK_DRAW,
+	
+	NUM_PROFILE_TRACKS
+};
+
+enum {
+	/* Hilo de la simulación */
+	PROFILE_SIM_INPUT = 0,
+	PROFILE_SIM_SPAWN,
+	PROFILE_SIM_UPDATE,
+	PROFILE_SIM_EMIT,
+	PROFILE_SIM_SLEEP,
+	
+	/* Hilo que dibuja */
+	PROFILE_DRAW_EVENTS,
+	PROFILE_DRAW_CULL,
+	PROFILE_DRAW_BACKGROUND,
+	PROFILE_DRAW_SPRITES,
+	PROFILE_DRAW_OVERLAY,
+	PROFILE_DRAW_PRESENT,
+	PROFILE_DRAW_WAIT,
+	
+	NUM_PROFILE_PHASES
+};
+
+#ifdef ENABLE_PROFILER
+void profiler_init (void);
+void profiler_start (int track);
+void profiler_lap (int phase);
+void profiler_commit (int track);
+void profiler_toggle (void);
+int profiler_draw_overlay (SDL_Surface *dst, SDL_Rect *area);
+
+#define PROFILE_START(track) profiler_start (track)
+#define PROFILE_LAP(phase) profiler_lap (phase)
+#define PROFILE_COMMIT(track) profiler_commit (track)
+#else
+/* Sin --enable-profiler no queda nada en el código */
+#define PROFILE_START(track) do { } while (0)
+#define PROFILE_LAP(phase) do { } while (0)
+#define PROFILE_COMMIT(track) do { } while (0)
+#endif
+
+#endif /* __PROFILER_H__ */
+
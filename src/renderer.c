@@ -0,0 +1,364 @@
+/*
+ * renderer.c
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL.h>
+
+#include "renderer.h"
+#include "compositor.h"
+#include "profiler.h"
+#include "perf-counters.h"
+#include "sdl2_rect.h"
+#include "trace.h"
+
+/*
+ * Dibuja una lista de cuadro sobre la capa fija.
+ *
+ * Primero se descartan los elementos que quedan fuera de la pantalla o son
+ * invisibles, y el resto se ordena por capa sin alterar el orden dentro de
+ * cada capa. Luego, por cada mosaico de COMPOSITOR_TILE x COMPOSITOR_TILE se
+ * calcula un hash de los dibujos que lo tocan (superficie, recortes y alfa).
+ * Sólo los mosaicos cuyo hash cambió respecto al cuadro anterior se
+ * restauran de la capa fija y se vuelven a dibujar; el resto de la pantalla
+ * ya tiene exactamente lo mismo. Los mosaicos sucios se juntan en
+ * rectángulos para presentar sólo esa parte.
+ *
+ * Cada elemento se coloca entre su posición actual y la del siguiente paso
+ * según phase (de 0 a DISPLAY_PHASE_ONE); los marcados con DISPLAY_FOLLOW
+ * se recorren además follow_dx pixeles en horizontal.
+ *
+ * Si una superficie cambia de contenido sin cambiar de apuntador, hay que
+ * llamar a renderer_invalidate para redibujar todo. Quien dibuje encima de
+ * la pantalla por su cuenta usa renderer_invalidate_rect para que esa parte
+ * se restaure en el siguiente cuadro.
+ */
+
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+typedef struct {
+	SDL_Surface *surface;
+	SDL_Rect src, dst;
+	int alpha;
+	int layer;
+} RendererOp;
+
+struct _Renderer {
+	SDL_Surface *screen;
+	StaticLayer *layer;
+	RendererResolve resolve;
+	Compositor *comp;
+	
+	int cols, rows;
+	Uint64 *hashes, *prev;
+	Uint8 *mask, *force;
+	int invalid;
+	
+	RendererOp *ops;
+	int n_ops, max_ops;
+	
+	SDL_Rect *rects;
+};
+
+Renderer * renderer_new (SDL_Surface *screen, StaticLayer *layer, RendererResolve resolve) {
+	Renderer *r;
+	int n;
+	
+	r = (Renderer *) malloc (sizeof (Renderer));
+	if (r == NULL) return NULL;
+	
+	r->screen = screen;
+	r->layer = layer;
+	r->resolve = resolve;
+	r->cols = (screen->w + COMPOSITOR_TILE - 1) / COMPOSITOR_TILE;
+	r->rows = (screen->h + COMPOSITOR_TILE - 1) / COMPOSITOR_TILE;
+	r->invalid = 1;
+	r->ops = NULL;
+	r->n_ops = r->max_ops = 0;
+	
+	n = r->cols * r->rows;
+	r->comp = compositor_new (screen);
+	r->hashes = (Uint64 *) malloc (n * sizeof (Uint64));
+	r->prev = (Uint64 *) malloc (n * sizeof (Uint64));
+	r->mask = (Uint8 *) malloc (n);
+	r->force = (Uint8 *) calloc (n, 1);
+	r->rects = (SDL_Rect *) malloc (n * sizeof (SDL_Rect));
+	
+	if (r->comp == NULL || r->hashes == NULL || r->prev == NULL || r->mask == NULL || r->force == NULL || r->rects == NULL) {
+		renderer_free (r);
+		return NULL;
+	}
+	
+	return r;
+}
+
+void renderer_free (Renderer *r) {
+	if (r == NULL) return;
+	
+	compositor_free (r->comp);
+	free (r->hashes);
+	free (r->prev);
+	free (r->mask);
+	free (r->force);
+	free (r->rects);
+	free (r->ops);
+	free (r);
+}
+
+void renderer_invalidate (Renderer *r) {
+	r->invalid = 1;
+}
+
+void renderer_invalidate_rect (Renderer *r, SDL_Rect *rect) {
+	int tx, ty, tx1, ty1;
+	
+	if (rect->w == 0 || rect->h == 0) return;
+	
+	tx1 = (rect->x + rect->w - 1) / COMPOSITOR_TILE;
+	ty1 = (rect->y + rect->h - 1) / COMPOSITOR_TILE;
+	if (tx1 >= r->cols) tx1 = r->cols - 1;
+	if (ty1 >= r->rows) ty1 = r->rows - 1;
+	
+	for (ty = (rect->y < 0 ? 0 : rect->y / COMPOSITOR_TILE); ty <= ty1; ty++) {
+		for (tx = (rect->x < 0 ? 0 : rect->x / COMPOSITOR_TILE); tx <= tx1; tx++) {
+			r->force[ty * r->cols + tx] = 1;
+		}
+	}
+}
+
+static Uint64 renderer_hash (Uint64 hash, const void *data, int len) {
+	const Uint8 *p = (const Uint8 *) data;
+	int g;
+	
+	for (g = 0; g < len; g++) {
+		hash = (hash ^ p[g]) * FNV_PRIME;
+	}
+	
+	return hash;
+}
+
+/* Coloca y recorta el elemento a la pantalla, devuelve 0 si no se ve */
+static int renderer_clip (Renderer *r, DisplayItem *item, int phase, int follow_dx, RendererOp *op) {
+	SDL_Surface *surface;
+	SDL_Rect whole, part, src;
+	int x, y;
+	
+	if (item->alpha == 0) return 0;
+	
+	surface = r->resolve (item->sprite);
+	if (surface == NULL) return 0;
+	
+	x = item->x + ((item->x1 - item->x) * phase) / DISPLAY_PHASE_ONE;
+	y = item->y + ((item->y1 - item->y) * phase) / DISPLAY_PHASE_ONE;
+	src = item->src;
+	
+	if (item->flags & DISPLAY_FOLLOW) {
+		x += follow_dx;
+		src.x += follow_dx;
+	}
+	
+	whole.x = whole.y = 0;
+	whole.w = surface->w;
+	whole.h = surface->h;
+	
+	if (src.w == 0) {
+		op->src = whole;
+	} else if (!SDL_IntersectRect (&src, &whole, &op->src)) {
+		return 0;
+	}
+	
+	op->dst.x = x + (op->src.x - (src.w == 0 ? 0 : src.x));
+	op->dst.y = y + (op->src.y - (src.w == 0 ? 0 : src.y));
+	op->dst.w = op->src.w;
+	op->dst.h = op->src.h;
+	
+	if (!SDL_IntersectRect (&op->dst, &r->screen->clip_rect, &part)) return 0;
+	
+	op->src.x += part.x - op->dst.x;
+	op->src.y += part.y - op->dst.y;
+	op->src.w = part.w;
+	op->src.h = part.h;
+	op->dst = part;
+	
+	op->surface = surface;
+	op->alpha = item->alpha;
+	op->layer = item->layer;
+	
+	return 1;
+}
+
+static int renderer_collect (Renderer *r, DisplayList *list, int phase, int follow_dx) {
+	RendererOp *bigger, op;
+	int g, h;
+	
+	r->n_ops = 0;
+	for (g = 0; g < list->count; g++) {
+		if (!renderer_clip (r, &list->items[g], phase, follow_dx, &op)) continue;
+		
+		if (r->n_ops == r->max_ops) {
+			bigger = (RendererOp *) realloc (r->ops, (r->max_ops + 64) * sizeof (RendererOp));
+			if (bigger == NULL) return -1;
+			r->ops = bigger;
+			r->max_ops += 64;
+		}
+		
+		/* Inserción ordenada por capa, estable; la lista casi siempre
+		 * llega ya en orden */
+		h = r->n_ops;
+		while (h > 0 && r->ops[h - 1].layer > op.layer) {
+			r->ops[h] = r->ops[h - 1];
+			h--;
+		}
+		r->ops[h] = op;
+		r->n_ops++;
+	}
+	
+	return 0;
+}
+
+static void renderer_hash_tiles (Renderer *r) {
+	RendererOp *op;
+	Uint64 *hash;
+	int g, tx, ty, tx1, ty1;
+	
+	for (g = 0; g < r->cols * r->rows; g++) {
+		r->hashes[g] = FNV_OFFSET;
+	}
+	
+	for (g = 0; g < r->n_ops; g++) {
+		op = &r->ops[g];
+		
+		tx1 = (op->dst.x + op->dst.w - 1) / COMPOSITOR_TILE;
+		ty1 = (op->dst.y + op->dst.h - 1) / COMPOSITOR_TILE;
+		for (ty = op->dst.y / COMPOSITOR_TILE; ty <= ty1; ty++) {
+			for (tx = op->dst.x / COMPOSITOR_TILE; tx <= tx1; tx++) {
+				hash = &r->hashes[ty * r->cols + tx];
+				*hash = renderer_hash (*hash, &op->surface, sizeof (op->surface));
+				*hash = renderer_hash (*hash, &op->src, sizeof (SDL_Rect));
+				*hash = renderer_hash (*hash, &op->dst, sizeof (SDL_Rect));
+				*hash = renderer_hash (*hash, &op->alpha, sizeof (op->alpha));
+			}
+		}
+	}
+}
+
+/* Junta los mosaicos sucios en tiras por renglón, y las tiras iguales de
+ * renglones seguidos en un solo rectángulo */
+static int renderer_dirty_rects (Renderer *r) {
+	SDL_Rect rect, *last;
+	int n = 0, tx, ty, start, row_first;
+	
+	for (ty = 0; ty < r->rows; ty++) {
+		row_first = n;
+		tx = 0;
+		while (tx < r->cols) {
+			if (!r->mask[ty * r->cols + tx]) {
+				tx++;
+				continue;
+			}
+			
+			start = tx;
+			while (tx < r->cols && r->mask[ty * r->cols + tx]) tx++;
+			
+			rect.x = start * COMPOSITOR_TILE;
+			rect.y = ty * COMPOSITOR_TILE;
+			rect.w = tx * COMPOSITOR_TILE - rect.x;
+			rect.h = COMPOSITOR_TILE;
+			if (rect.x + rect.w > r->screen->w) rect.w = r->screen->w - rect.x;
+			if (rect.y + rect.h > r->screen->h) rect.h = r->screen->h - rect.y;
+			
+			/* Buscar la misma tira en el renglón anterior */
+			for (last = r->rects; last < r->rects + row_first; last++) {
+				if (last->x == rect.x && last->w == rect.w && last->y + last->h == rect.y) break;
+			}
+			
+			if (last < r->rects + row_first) {
+				last->h += rect.h;
+			} else {
+				r->rects[n++] = rect;
+			}
+		}
+	}
+	
+	return n;
+}
+
+int renderer_draw (Renderer *r, DisplayList *list, int phase, int follow_dx, SDL_Rect **dirty) {
+	RendererOp *op;
+	Uint64 *swap;
+	int g, n, all;
+	
+	all = r->invalid;
+	if (static_layer_update (r->layer)) all = 1;
+	
+	/* Si el destino se bloquea, el compositor dibuja en el momento y no
+	 * hay forma de limitarlo a unos mosaicos */
+	if (SDL_MUSTLOCK (r->screen)) all = 1;
+	
+	if (renderer_collect (r, list, phase, follow_dx) < 0) all = 1;
+	
+	renderer_hash_tiles (r);
+	
+	n = r->cols * r->rows;
+	for (g = 0; g < n; g++) {
+		r->mask[g] = (all || r->force[g] || r->hashes[g] != r->prev[g]);
+		r->force[g] = 0;
+	}
+	
+	swap = r->prev;
+	r->prev = r->hashes;
+	r->hashes = swap;
+	r->invalid = 0;
+	
+	n = renderer_dirty_rects (r);
+	*dirty = r->rects;
+	PROFILE_LAP (PROFILE_DRAW_CULL);
+	if (n == 0) return 0;
+	
+	PERF_BEGIN (PERF_REGION_BLITS);
+	TRACE_BEGIN ("background blits");
+	for (g = 0; g < n; g++) {
+		static_layer_draw_rect (r->layer, r->screen, &r->rects[g]);
+	}
+	TRACE_END ("background blits");
+	PROFILE_LAP (PROFILE_DRAW_BACKGROUND);
+	
+	TRACE_BEGIN ("sprite blits");
+	for (g = 0; g < r->n_ops; g++) {
+		op = &r->ops[g];
+		if (op->alpha == DISPLAY_NO_ALPHA) {
+			compositor_blit (r->comp, op->surface, &op->src, &op->dst);
+		} else {
+			compositor_blit_alpha (r->comp, op->surface, &op->src, &op->dst, op->alpha);
+		}
+	}
+	
+	compositor_flush_tiles (r->comp, r->mask);
+	TRACE_END ("sprite blits");
+	PERF_END (PERF_REGION_BLITS);
+	PROFILE_LAP (PROFILE_DRAW_SPRITES);
+	
+	return n;
+}
+
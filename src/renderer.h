@@ -0,0 +1,43 @@
+/*
+ * renderer.h
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef __RENDERER_H__
+#define __RENDERER_H__
+
+#include <SDL.h>
+
+#include "display-list.h"
+#include "static-layer.h"
+
+/* Traduce el número de imagen de la lista a una superficie */
+typedef SDL_Surface * (*RendererResolve) (int sprite);
+
+typedef struct _Renderer Renderer;
+
+Renderer * renderer_new (SDL_Surface *screen, StaticLayer *layer, RendererResolve resolve);
+void renderer_free (Renderer *r);
+void renderer_invalidate (Renderer *r);
+void renderer_invalidate_rect (Renderer *r, SDL_Rect *rect);
+int renderer_draw (Renderer *r, DisplayList *list, int phase, int follow_dx, SDL_Rect **dirty);
+
+#endif /* __RENDERER_H__ */
+
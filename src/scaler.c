@@ -0,0 +1,399 @@
+/*
+ * scaler.c
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL.h>
+
+#if defined (__GNUC__) && (defined (__i386__) || defined (__x86_64__))
+#define SCALER_HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "scaler.h"
+#include "workers.h"
+
+/*
+ * Ampliar la pantalla del juego por un factor entero (2, 3 o 4).
+ *
+ * Con SCALER_NEAREST cada pixel se repite factor x factor veces. Con
+ * SCALER_SCALE2X se usa Scale2x (EPX) para 2x, Scale3x para 3x y Scale2x dos
+ * veces para 4x: los bordes diagonales se suavizan sin mezclar colores.
+ *
+ * Origen y destino deben tener el mismo formato de 16 o 32 bits. Sólo se
+ * procesa el rectángulo indicado del origen, por bandas de renglones que se
+ * reparten entre los hilos de workers.c. Las partes que más trabajan
+ * (repetir pixeles y Scale2x) tienen versión SSE2.
+ */
+
+#define SCALER_BAND_ROWS 16
+
+typedef struct {
+	SDL_Surface *src, *dst;
+	SDL_Rect rect;
+	int factor, filter;
+} ScalerJob;
+
+/* Superficie intermedia para 4x con Scale2x */
+static SDL_Surface *scaler_temp = NULL;
+static int scaler_use_sse2 = -1;
+
+static inline Uint32 scaler_get (const Uint8 *row, int x, int bpp) {
+	if (bpp == 2) return ((const Uint16 *) row)[x];
+	return ((const Uint32 *) row)[x];
+}
+
+static inline void scaler_put (Uint8 *row, int x, int bpp, Uint32 p) {
+	if (bpp == 2) {
+		((Uint16 *) row)[x] = p;
+	} else {
+		((Uint32 *) row)[x] = p;
+	}
+}
+
+#ifdef SCALER_HAVE_SSE2
+/* Repetir 2 o 4 veces cada pixel, devuelve cuántos quedaron hechos */
+__attribute__ ((target ("sse2")))
+static int scaler_nearest_sse2 (const Uint8 *s, Uint8 *out, int w, int bpp, int factor) {
+	__m128i v, lo, hi;
+	int x, step = 16 / bpp;
+	
+	for (x = 0; x + step <= w; x += step) {
+		v = _mm_loadu_si128 ((const __m128i *) (s + x * bpp));
+		if (bpp == 2) {
+			lo = _mm_unpacklo_epi16 (v, v);
+			hi = _mm_unpackhi_epi16 (v, v);
+		} else {
+			lo = _mm_unpacklo_epi32 (v, v);
+			hi = _mm_unpackhi_epi32 (v, v);
+		}
+		
+		if (factor == 2) {
+			_mm_storeu_si128 ((__m128i *) out, lo);
+			_mm_storeu_si128 ((__m128i *) (out + 16), hi);
+			out += 32;
+		} else if (bpp == 2) {
+			_mm_storeu_si128 ((__m128i *) out, _mm_unpacklo_epi16 (lo, lo));
+			_mm_storeu_si128 ((__m128i *) (out + 16), _mm_unpackhi_epi16 (lo, lo));
+			_mm_storeu_si128 ((__m128i *) (out + 32), _mm_unpacklo_epi16 (hi, hi));
+			_mm_storeu_si128 ((__m128i *) (out + 48), _mm_unpackhi_epi16 (hi, hi));
+			out += 64;
+		} else {
+			_mm_storeu_si128 ((__m128i *) out, _mm_unpacklo_epi32 (lo, lo));
+			_mm_storeu_si128 ((__m128i *) (out + 16), _mm_unpackhi_epi32 (lo, lo));
+			_mm_storeu_si128 ((__m128i *) (out + 32), _mm_unpacklo_epi32 (hi, hi));
+			_mm_storeu_si128 ((__m128i *) (out + 48), _mm_unpackhi_epi32 (hi, hi));
+			out += 64;
+		}
+	}
+	
+	return x;
+}
+#endif
+
+/* Repetir cada pixel, las copias verticales son memcpy del primer renglón */
+static void scaler_nearest_row (const Uint8 *s, Uint8 *d, int pitch, int x0, int w, int bpp, int factor) {
+	int x, k;
+	Uint32 p;
+	Uint8 *first;
+	
+	first = d + x0 * factor * bpp;
+	x = 0;
+	
+#ifdef SCALER_HAVE_SSE2
+	if (scaler_use_sse2 && factor != 3) {
+		x = scaler_nearest_sse2 (s + x0 * bpp, first, w, bpp, factor);
+	}
+#endif
+	
+	for (; x < w; x++) {
+		p = scaler_get (s, x0 + x, bpp);
+		for (k = 0; k < factor; k++) {
+			scaler_put (first, x * factor + k, bpp, p);
+		}
+	}
+	
+	for (k = 1; k < factor; k++) {
+		memcpy (first + k * pitch, first, w * factor * bpp);
+	}
+}
+
+/*
+ * Scale2x de un renglón:
+ *   B        E0 E1
+ * D E F  ->  E2 E3
+ *   H
+ */
+static void scaler_scale2x_pixel (const Uint8 *above, const Uint8 *cur, const Uint8 *below, Uint8 *d0, Uint8 *d1, int x, int w, int bpp) {
+	Uint32 b, dd, e, f, h;
+	
+	b = scaler_get (above, x, bpp);
+	e = scaler_get (cur, x, bpp);
+	h = scaler_get (below, x, bpp);
+	dd = scaler_get (cur, (x > 0 ? x - 1 : x), bpp);
+	f = scaler_get (cur, (x < w - 1 ? x + 1 : x), bpp);
+	
+	if (b != h && dd != f) {
+		scaler_put (d0, 2 * x, bpp, dd == b ? dd : e);
+		scaler_put (d0, 2 * x + 1, bpp, b == f ? f : e);
+		scaler_put (d1, 2 * x, bpp, dd == h ? dd : e);
+		scaler_put (d1, 2 * x + 1, bpp, h == f ? f : e);
+	} else {
+		scaler_put (d0, 2 * x, bpp, e);
+		scaler_put (d0, 2 * x + 1, bpp, e);
+		scaler_put (d1, 2 * x, bpp, e);
+		scaler_put (d1, 2 * x + 1, bpp, e);
+	}
+}
+
+#ifdef SCALER_HAVE_SSE2
+/* Las mismas reglas con máscaras, 8 pixeles de 16 bits o 4 de 32 a la vez */
+#define SCALER_SCALE2X_SSE2(name, cmpeq, unpacklo, unpackhi, size) \
+__attribute__ ((target ("sse2"))) \
+static int name (const Uint8 *above, const Uint8 *cur, const Uint8 *below, Uint8 *d0, Uint8 *d1, int x, int last) { \
+	__m128i b, dd, e, f, h, ones, cond, e0, e1, e2, e3, m; \
+	\
+	ones = _mm_set1_epi32 (-1); \
+	for (; x + 16 / size <= last; x += 16 / size) { \
+		b = _mm_loadu_si128 ((const __m128i *) (above + x * size)); \
+		e = _mm_loadu_si128 ((const __m128i *) (cur + x * size)); \
+		h = _mm_loadu_si128 ((const __m128i *) (below + x * size)); \
+		dd = _mm_loadu_si128 ((const __m128i *) (cur + (x - 1) * size)); \
+		f = _mm_loadu_si128 ((const __m128i *) (cur + (x + 1) * size)); \
+		\
+		cond = _mm_andnot_si128 (cmpeq (b, h), _mm_andnot_si128 (cmpeq (dd, f), ones)); \
+		m = _mm_and_si128 (cond, cmpeq (dd, b)); \
+		e0 = _mm_or_si128 (_mm_and_si128 (m, dd), _mm_andnot_si128 (m, e)); \
+		m = _mm_and_si128 (cond, cmpeq (b, f)); \
+		e1 = _mm_or_si128 (_mm_and_si128 (m, f), _mm_andnot_si128 (m, e)); \
+		m = _mm_and_si128 (cond, cmpeq (dd, h)); \
+		e2 = _mm_or_si128 (_mm_and_si128 (m, dd), _mm_andnot_si128 (m, e)); \
+		m = _mm_and_si128 (cond, cmpeq (h, f)); \
+		e3 = _mm_or_si128 (_mm_and_si128 (m, f), _mm_andnot_si128 (m, e)); \
+		\
+		_mm_storeu_si128 ((__m128i *) (d0 + 2 * x * size), unpacklo (e0, e1)); \
+		_mm_storeu_si128 ((__m128i *) (d0 + 2 * x * size + 16), unpackhi (e0, e1)); \
+		_mm_storeu_si128 ((__m128i *) (d1 + 2 * x * size), unpacklo (e2, e3)); \
+		_mm_storeu_si128 ((__m128i *) (d1 + 2 * x * size + 16), unpackhi (e2, e3)); \
+	} \
+	return x; \
+}
+
+SCALER_SCALE2X_SSE2 (scaler_scale2x_sse2_16, _mm_cmpeq_epi16, _mm_unpacklo_epi16, _mm_unpackhi_epi16, 2)
+SCALER_SCALE2X_SSE2 (scaler_scale2x_sse2_32, _mm_cmpeq_epi32, _mm_unpacklo_epi32, _mm_unpackhi_epi32, 4)
+#endif
+
+static void scaler_scale2x_row (const Uint8 *above, const Uint8 *cur, const Uint8 *below, Uint8 *d0, Uint8 *d1, int x0, int x1, int w, int bpp) {
+	int x = x0;
+	
+#ifdef SCALER_HAVE_SSE2
+	int first, last;
+	
+	if (scaler_use_sse2) {
+		/* Los pixeles de las orillas de la imagen van por el camino normal */
+		first = (x0 > 0 ? x0 : 1);
+		last = (x1 < w - 1 ? x1 : w - 1);
+		
+		for (; x < first && x < x1; x++) {
+			scaler_scale2x_pixel (above, cur, below, d0, d1, x, w, bpp);
+		}
+		
+		if (x < last) {
+			if (bpp == 2) {
+				x = scaler_scale2x_sse2_16 (above, cur, below, d0, d1, x, last);
+			} else {
+				x = scaler_scale2x_sse2_32 (above, cur, below, d0, d1, x, last);
+			}
+		}
+	}
+#endif
+	
+	for (; x < x1; x++) {
+		scaler_scale2x_pixel (above, cur, below, d0, d1, x, w, bpp);
+	}
+}
+
+/*
+ * Scale3x de un renglón:
+ * A B C      E0 E1 E2
+ * D E F  ->  E3 E4 E5
+ * G H I      E6 E7 E8
+ */
+static void scaler_scale3x_row (const Uint8 *above, const Uint8 *cur, const Uint8 *below, Uint8 *d0, Uint8 *d1, Uint8 *d2, int x0, int x1, int w, int bpp) {
+	Uint32 a, b, c, dd, e, f, g, h, i;
+	int x, l, r;
+	
+	for (x = x0; x < x1; x++) {
+		l = (x > 0 ? x - 1 : x);
+		r = (x < w - 1 ? x + 1 : x);
+		
+		a = scaler_get (above, l, bpp); b = scaler_get (above, x, bpp); c = scaler_get (above, r, bpp);
+		dd = scaler_get (cur, l, bpp); e = scaler_get (cur, x, bpp); f = scaler_get (cur, r, bpp);
+		g = scaler_get (below, l, bpp); h = scaler_get (below, x, bpp); i = scaler_get (below, r, bpp);
+		
+		if (b != h && dd != f) {
+			scaler_put (d0, 3 * x, bpp, dd == b ? dd : e);
+			scaler_put (d0, 3 * x + 1, bpp, ((dd == b && e != c) || (b == f && e != a)) ? b : e);
+			scaler_put (d0, 3 * x + 2, bpp, b == f ? f : e);
+			scaler_put (d1, 3 * x, bpp, ((dd == b && e != g) || (dd == h && e != a)) ? dd : e);
+			scaler_put (d1, 3 * x + 1, bpp, e);
+			scaler_put (d1, 3 * x + 2, bpp, ((b == f && e != i) || (h == f && e != c)) ? f : e);
+			scaler_put (d2, 3 * x, bpp, dd == h ? dd : e);
+			scaler_put (d2, 3 * x + 1, bpp, ((dd == h && e != i) || (h == f && e != g)) ? h : e);
+			scaler_put (d2, 3 * x + 2, bpp, h == f ? f : e);
+		} else {
+			scaler_put (d0, 3 * x, bpp, e); scaler_put (d0, 3 * x + 1, bpp, e); scaler_put (d0, 3 * x + 2, bpp, e);
+			scaler_put (d1, 3 * x, bpp, e); scaler_put (d1, 3 * x + 1, bpp, e); scaler_put (d1, 3 * x + 2, bpp, e);
+			scaler_put (d2, 3 * x, bpp, e); scaler_put (d2, 3 * x + 1, bpp, e); scaler_put (d2, 3 * x + 2, bpp, e);
+		}
+	}
+}
+
+static void scaler_band (void *data, int band) {
+	ScalerJob *job = (ScalerJob *) data;
+	SDL_Surface *src = job->src, *dst = job->dst;
+	const Uint8 *above, *cur, *below;
+	Uint8 *d;
+	int y, last, bpp, x0, x1;
+	
+	bpp = src->format->BytesPerPixel;
+	x0 = job->rect.x;
+	x1 = job->rect.x + job->rect.w;
+	
+	y = job->rect.y + band * SCALER_BAND_ROWS;
+	last = y + SCALER_BAND_ROWS;
+	if (last > job->rect.y + job->rect.h) last = job->rect.y + job->rect.h;
+	
+	for (; y < last; y++) {
+		cur = (const Uint8 *) src->pixels + y * src->pitch;
+		d = (Uint8 *) dst->pixels + y * job->factor * dst->pitch;
+		
+		if (job->filter == SCALER_NEAREST) {
+			scaler_nearest_row (cur, d, dst->pitch, x0, job->rect.w, bpp, job->factor);
+			continue;
+		}
+		
+		above = (y > 0 ? cur - src->pitch : cur);
+		below = (y < src->h - 1 ? cur + src->pitch : cur);
+		
+		if (job->factor == 2) {
+			scaler_scale2x_row (above, cur, below, d, d + dst->pitch, x0, x1, src->w, bpp);
+		} else {
+			scaler_scale3x_row (above, cur, below, d, d + dst->pitch, d + 2 * dst->pitch, x0, x1, src->w, bpp);
+		}
+	}
+}
+
+static void scaler_run (SDL_Surface *src, SDL_Rect *rect, SDL_Surface *dst, int factor, int filter) {
+	ScalerJob job;
+	
+	job.src = src;
+	job.dst = dst;
+	job.rect = *rect;
+	job.factor = factor;
+	job.filter = filter;
+	
+	workers_run (scaler_band, &job, (rect->h + SCALER_BAND_ROWS - 1) / SCALER_BAND_ROWS);
+}
+
+int scaler_blit (SDL_Surface *src, SDL_Rect *rect, SDL_Surface *dst, int factor, int filter) {
+	SDL_Rect r, grown, twice;
+	int bpp, x, y, w, h;
+	
+	bpp = src->format->BytesPerPixel;
+	if ((bpp != 2 && bpp != 4) || dst->format->BytesPerPixel != bpp) return -1;
+	if (factor < 2 || factor > 4) return -1;
+	if (dst->w < src->w * factor || dst->h < src->h * factor) return -1;
+	
+	if (scaler_use_sse2 < 0) {
+		scaler_use_sse2 = 0;
+#ifdef SCALER_HAVE_SSE2
+		__builtin_cpu_init ();
+		scaler_use_sse2 = __builtin_cpu_supports ("sse2");
+#endif
+	}
+	
+	/* Recortar con enteros con signo, los campos de SDL_Rect no sirven
+	 * para ver si el ancho quedó negativo */
+	if (rect == NULL) {
+		x = y = 0;
+		w = src->w;
+		h = src->h;
+	} else {
+		x = rect->x;
+		y = rect->y;
+		w = rect->w;
+		h = rect->h;
+		if (x < 0) {
+			w += x;
+			x = 0;
+		}
+		if (y < 0) {
+			h += y;
+			y = 0;
+		}
+		if (src->w - x < w) w = src->w - x;
+		if (src->h - y < h) h = src->h - y;
+	}
+	if (w <= 0 || h <= 0) return 0;
+	
+	r.x = x;
+	r.y = y;
+	r.w = w;
+	r.h = h;
+	
+	if (filter == SCALER_NEAREST || factor != 4) {
+		scaler_run (src, &r, dst, factor, filter);
+		return 0;
+	}
+	
+	/* 4x: primero 2x a la intermedia con un pixel de margen, para que el
+	 * segundo paso tenga vecinos correctos alrededor del rectángulo */
+	if (scaler_temp == NULL || scaler_temp->w != src->w * 2 || scaler_temp->h != src->h * 2 || scaler_temp->format->BytesPerPixel != bpp) {
+		if (scaler_temp != NULL) SDL_FreeSurface (scaler_temp);
+		scaler_temp = SDL_CreateRGBSurface (SDL_SWSURFACE, src->w * 2, src->h * 2, src->format->BitsPerPixel, src->format->Rmask, src->format->Gmask, src->format->Bmask, src->format->Amask);
+		if (scaler_temp == NULL) return -1;
+	}
+	
+	grown.x = (r.x > 0 ? r.x - 1 : 0);
+	grown.y = (r.y > 0 ? r.y - 1 : 0);
+	grown.w = (r.x + r.w < src->w ? r.x + r.w + 1 : src->w) - grown.x;
+	grown.h = (r.y + r.h < src->h ? r.y + r.h + 1 : src->h) - grown.y;
+	scaler_run (src, &grown, scaler_temp, 2, SCALER_SCALE2X);
+	
+	twice.x = r.x * 2;
+	twice.y = r.y * 2;
+	twice.w = r.w * 2;
+	twice.h = r.h * 2;
+	scaler_run (scaler_temp, &twice, dst, 2, SCALER_SCALE2X);
+	
+	return 0;
+}
+
+void scaler_free (void) {
+	if (scaler_temp != NULL) {
+		SDL_FreeSurface (scaler_temp);
+		scaler_temp = NULL;
+	}
+}
+
@@ -0,0 +1,566 @@
+/*
+ * sdf-text.c
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <SDL.h>
+#include <SDL_ttf.h>
+
+#include "sdf-text.h"
+
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+#define RMASK 0xff000000
+#define GMASK 0x00ff0000
+#define BMASK 0x0000ff00
+#define AMASK 0x000000ff
+#else
+#define RMASK 0x000000ff
+#define GMASK 0x0000ff00
+#define BMASK 0x00ff0000
+#define AMASK 0xff000000
+#endif
+
+/*
+ * Texto dibujado desde un campo de distancias (SDF).
+ *
+ * Cada glifo se renderiza una sola vez a SDF_BASE_SIZE pixeles y se guarda
+ * en un atlas como la distancia con signo al borde más cercano, positiva
+ * dentro de la letra. Con eso se puede dibujar a cualquier tamaño, y el
+ * contorno y la sombra salen de la misma distancia, en una sola pasada.
+ */
+
+#define SDF_BASE_SIZE 64
+#define SDF_SPREAD 8
+#define SDF_ATLAS_WIDTH 1024
+
+#define SDF_FIRST_CHAR 32
+#define SDF_LAST_CHAR 255
+#define SDF_NUM_CHARS (SDF_LAST_CHAR - SDF_FIRST_CHAR + 1)
+
+typedef struct {
+	int provided;
+	int x, y, w, h; /* Lugar en el atlas, incluye el margen de SDF_SPREAD */
+	int advance;
+} SDFGlyph;
+
+struct _SDFFont {
+	SDFGlyph glyphs[SDF_NUM_CHARS];
+	
+	int height, line_skip;
+	
+	Uint8 *atlas;
+	int atlas_h;
+};
+
+/* ----- Transformada de distancia 8SSEDT ----- */
+
+typedef struct {
+	int dx, dy;
+} SDFPoint;
+
+#define SDF_FAR 9999
+
+static inline int sdf_dist2 (SDFPoint p) {
+	return p.dx * p.dx + p.dy * p.dy;
+}
+
+static inline void sdf_compare (SDFPoint *grid, int w, int h, SDFPoint *p, int x, int y, int ox, int oy) {
+	SDFPoint other;
+	
+	x += ox;
+	y += oy;
+	
+	if (x < 0 || y < 0 || x >= w || y >= h) return;
+	
+	other = grid[y * w + x];
+	other.dx += ox;
+	other.dy += oy;
+	
+	if (sdf_dist2 (other) < sdf_dist2 (*p)) *p = other;
+}
+
+static void sdf_edt (SDFPoint *grid, int w, int h) {
+	int x, y;
+	SDFPoint p;
+	
+	for (y = 0; y < h; y++) {
+		for (x = 0; x < w; x++) {
+			p = grid[y * w + x];
+			sdf_compare (grid, w, h, &p, x, y, -1, 0);
+			sdf_compare (grid, w, h, &p, x, y, 0, -1);
+			sdf_compare (grid, w, h, &p, x, y, -1, -1);
+			sdf_compare (grid, w, h, &p, x, y, 1, -1);
+			grid[y * w + x] = p;
+		}
+		
+		for (x = w - 1; x >= 0; x--) {
+			p = grid[y * w + x];
+			sdf_compare (grid, w, h, &p, x, y, 1, 0);
+			grid[y * w + x] = p;
+		}
+	}
+	
+	for (y = h - 1; y >= 0; y--) {
+		for (x = w - 1; x >= 0; x--) {
+			p = grid[y * w + x];
+			sdf_compare (grid, w, h, &p, x, y, 1, 0);
+			sdf_compare (grid, w, h, &p, x, y, 0, 1);
+			sdf_compare (grid, w, h, &p, x, y, -1, 1);
+			sdf_compare (grid, w, h, &p, x, y, 1, 1);
+			grid[y * w + x] = p;
+		}
+		
+		for (x = 0; x < w; x++) {
+			p = grid[y * w + x];
+			sdf_compare (grid, w, h, &p, x, y, -1, 0);
+			grid[y * w + x] = p;
+		}
+	}
+}
+
+/* Convierte la cobertura del glifo en distancias y las escribe en el atlas.
+ * Regresa -1 si no hubo memoria */
+static int sdf_build_glyph (SDL_Surface *surface, Uint8 *dest, int pitch, int w, int h) {
+	SDFPoint *inside, *outside;
+	SDFPoint far = {SDF_FAR, SDF_FAR}, zero = {0, 0};
+	Uint32 *pixels;
+	Uint8 a;
+	int x, y, sx, sy, in;
+	double d;
+	
+	inside = (SDFPoint *) malloc (sizeof (SDFPoint) * w * h);
+	outside = (SDFPoint *) malloc (sizeof (SDFPoint) * w * h);
+	if (inside == NULL || outside == NULL) {
+		free (inside);
+		free (outside);
+		return -1;
+	}
+	
+	SDL_LockSurface (surface);
+	for (y = 0; y < h; y++) {
+		for (x = 0; x < w; x++) {
+			sx = x - SDF_SPREAD;
+			sy = y - SDF_SPREAD;
+			in = 0;
+			
+			if (sx >= 0 && sy >= 0 && sx < surface->w && sy < surface->h) {
+				pixels = (Uint32 *) ((Uint8 *) surface->pixels + sy * surface->pitch);
+				a = (pixels[sx] & surface->format->Amask) >> surface->format->Ashift;
+				in = (a >= 128);
+			}
+			
+			inside[y * w + x] = in ? zero : far;
+			outside[y * w + x] = in ? far : zero;
+		}
+	}
+	SDL_UnlockSurface (surface);
+	
+	/* inside termina con la distancia a la letra, outside con la distancia al fondo */
+	sdf_edt (inside, w, h);
+	sdf_edt (outside, w, h);
+	
+	for (y = 0; y < h; y++) {
+		for (x = 0; x < w; x++) {
+			/* El borde está a medio pixel de los centros */
+			if (sdf_dist2 (inside[y * w + x]) == 0) {
+				d = sqrt (sdf_dist2 (outside[y * w + x])) - 0.5;
+			} else {
+				d = 0.5 - sqrt (sdf_dist2 (inside[y * w + x]));
+			}
+			
+			d = 128.0 + d * 127.0 / SDF_SPREAD;
+			if (d < 0.0) d = 0.0;
+			if (d > 255.0) d = 255.0;
+			
+			dest[y * pitch + x] = (Uint8) (d + 0.5);
+		}
+	}
+	
+	free (inside);
+	free (outside);
+	
+	return 0;
+}
+
+static int sdf_utf8_encode (int ch, char *buffer) {
+	if (ch < 0x80) {
+		buffer[0] = ch;
+		buffer[1] = '\0';
+		return 1;
+	}
+	
+	buffer[0] = 0xC0 | (ch >> 6);
+	buffer[1] = 0x80 | (ch & 0x3F);
+	buffer[2] = '\0';
+	return 2;
+}
+
+/* Lee el siguiente caracter de una cadena UTF-8. Lo que no cabe en
+ * el atlas se regresa como -1 */
+static int sdf_utf8_next (const char **text) {
+	const unsigned char *s = (const unsigned char *) *text;
+	int ch, extra;
+	
+	if (s[0] < 0x80) {
+		ch = s[0];
+		extra = 0;
+	} else if ((s[0] & 0xE0) == 0xC0) {
+		ch = s[0] & 0x1F;
+		extra = 1;
+	} else if ((s[0] & 0xF0) == 0xE0) {
+		ch = s[0] & 0x0F;
+		extra = 2;
+	} else {
+		ch = s[0] & 0x07;
+		extra = 3;
+	}
+	
+	s++;
+	while (extra > 0 && (*s & 0xC0) == 0x80) {
+		ch = (ch << 6) | (*s & 0x3F);
+		s++;
+		extra--;
+	}
+	
+	*text = (const char *) s;
+	
+	if (extra > 0 || ch < SDF_FIRST_CHAR || ch > SDF_LAST_CHAR) return -1;
+	return ch;
+}
+
+SDFFont * sdf_font_new (const char *filename) {
+	SDFFont *font;
+	TTF_Font *ttf;
+	SDL_Surface *rendered[SDF_NUM_CHARS];
+	SDL_Color white = {255, 255, 255};
+	SDFGlyph *glyph;
+	char buffer[4];
+	int g, ch, minx, maxx, miny, maxy, advance;
+	int pen_x, pen_y, row_h, failed;
+	
+	ttf = TTF_OpenFont (filename, SDF_BASE_SIZE);
+	if (ttf == NULL) return NULL;
+	
+	font = (SDFFont *) malloc (sizeof (SDFFont));
+	if (font == NULL) {
+		TTF_CloseFont (ttf);
+		return NULL;
+	}
+	
+	memset (font, 0, sizeof (SDFFont));
+	font->height = TTF_FontHeight (ttf);
+	font->line_skip = TTF_FontLineSkip (ttf);
+	
+	/* Renderizar cada glifo con el origen en la pluma, igual que lo acomoda
+	 * SDL_ttf dentro de una cadena, y repartirlos en renglones del atlas */
+	pen_x = pen_y = row_h = 0;
+	for (g = 0; g < SDF_NUM_CHARS; g++) {
+		ch = SDF_FIRST_CHAR + g;
+		glyph = &font->glyphs[g];
+		rendered[g] = NULL;
+		
+		if (!TTF_GlyphIsProvided (ttf, ch)) continue;
+		if (TTF_GlyphMetrics (ttf, ch, &minx, &maxx, &miny, &maxy, &advance) < 0) continue;
+		
+		glyph->provided = 1;
+		glyph->advance = advance;
+		
+		/* El espacio no tiene nada que dibujar */
+		if (ch == ' ') continue;
+		
+		sdf_utf8_encode (ch, buffer);
+		rendered[g] = TTF_RenderUTF8_Blended (ttf, buffer, white);
+		if (rendered[g] == NULL) continue;
+		
+		glyph->w = rendered[g]->w + SDF_SPREAD * 2;
+		glyph->h = rendered[g]->h + SDF_SPREAD * 2;
+		
+		if (pen_x + glyph->w > SDF_ATLAS_WIDTH) {
+			pen_x = 0;
+			pen_y += row_h;
+			row_h = 0;
+		}
+		
+		glyph->x = pen_x;
+		glyph->y = pen_y;
+		pen_x += glyph->w;
+		if (glyph->h > row_h) row_h = glyph->h;
+	}
+	
+	TTF_CloseFont (ttf);
+	
+	font->atlas_h = pen_y + row_h;
+	font->atlas = (Uint8 *) malloc (SDF_ATLAS_WIDTH * (font->atlas_h > 0 ? font->atlas_h : 1));
+	
+	/* Sin memoria se liberan de todos modos los glifos que faltan */
+	failed = (font->atlas == NULL);
+	for (g = 0; g < SDF_NUM_CHARS; g++) {
+		if (rendered[g] == NULL) continue;
+		
+		if (!failed) {
+			glyph = &font->glyphs[g];
+			if (sdf_build_glyph (rendered[g], font->atlas + glyph->y * SDF_ATLAS_WIDTH + glyph->x, SDF_ATLAS_WIDTH, glyph->w, glyph->h) < 0) failed = 1;
+		}
+		
+		SDL_FreeSurface (rendered[g]);
+	}
+	
+	if (failed) {
+		free (font->atlas);
+		free (font);
+		return NULL;
+	}
+	
+	return font;
+}
+
+void sdf_font_free (SDFFont *font) {
+	if (font == NULL) return;
+	
+	free (font->atlas);
+	free (font);
+}
+
+double sdf_glyph_advance (SDFFont *font, int ch, double size) {
+	if (ch < SDF_FIRST_CHAR || ch > SDF_LAST_CHAR || !font->glyphs[ch - SDF_FIRST_CHAR].provided) {
+		ch = ' ';
+	}
+	
+	return font->glyphs[ch - SDF_FIRST_CHAR].advance * size / SDF_BASE_SIZE;
+}
+
+/* Ancho de un renglón, hasta el salto de línea o el final */
+static double sdf_line_width (SDFFont *font, const char *text, double size) {
+	double w = 0.0;
+	int ch;
+	
+	while (*text != '\0' && *text != '\n') {
+		ch = sdf_utf8_next (&text);
+		w += sdf_glyph_advance (font, ch, size);
+	}
+	
+	return w;
+}
+
+int sdf_text_width (SDFFont *font, const char *text, double size) {
+	double w, maxw = 0.0;
+	
+	while (text != NULL) {
+		w = sdf_line_width (font, text, size);
+		if (w > maxw) maxw = w;
+		
+		text = strchr (text, '\n');
+		if (text != NULL) text++;
+	}
+	
+	return (int) ceil (maxw);
+}
+
+int sdf_line_skip (SDFFont *font, double size) {
+	return (int) (font->line_skip * size / SDF_BASE_SIZE + 0.5);
+}
+
+/* Muestreo bilineal del atlas, lo de fuera del glifo cuenta como fondo */
+static inline double sdf_sample (SDFFont *font, SDFGlyph *glyph, double u, double v) {
+	int x0, y0, x, y, i, j;
+	double fx, fy, val[2][2];
+	
+	x0 = (int) floor (u);
+	y0 = (int) floor (v);
+	fx = u - x0;
+	fy = v - y0;
+	
+	for (j = 0; j < 2; j++) {
+		for (i = 0; i < 2; i++) {
+			x = x0 + i;
+			y = y0 + j;
+			
+			if (x < 0 || y < 0 || x >= glyph->w || y >= glyph->h) {
+				val[j][i] = 0.0;
+			} else {
+				val[j][i] = font->atlas[(glyph->y + y) * SDF_ATLAS_WIDTH + glyph->x + x];
+			}
+		}
+	}
+	
+	return (val[0][0] * (1.0 - fx) + val[0][1] * fx) * (1.0 - fy) +
+	       (val[1][0] * (1.0 - fx) + val[1][1] * fx) * fy;
+}
+
+static inline double sdf_clamp01 (double v) {
+	if (v < 0.0) return 0.0;
+	if (v > 1.0) return 1.0;
+	return v;
+}
+
+SDL_Surface * sdf_render (SDFFont *font, const char *text, const SDFStyle *style) {
+	SDL_Surface *surface;
+	SDFGlyph *glyph;
+	float *dist;
+	Uint32 *pixels;
+	const char *line;
+	double scale, pen_x, x0, y0, u, v, d, ds;
+	double a_fill, a_outline, a_shadow, r, g, b, a;
+	int w, h, n_lines, line_skip, height;
+	int pad_l, pad_r, pad_t, pad_b, text_w;
+	int x, y, xs, ys, xe, ye, ch, line_n;
+	
+	if (text == NULL || text[0] == '\0') return NULL;
+	
+	scale = style->size / SDF_BASE_SIZE;
+	
+	for (line = text, n_lines = 1; *line != '\0'; line++) {
+		if (*line == '\n') n_lines++;
+	}
+	
+	line_skip = sdf_line_skip (font, style->size);
+	height = (int) (font->height * scale + 0.5);
+	text_w = sdf_text_width (font, text, style->size);
+	
+	/* Espacio extra para el contorno y la sombra */
+	pad_l = pad_r = pad_t = pad_b = (int) ceil (style->outline);
+	if (style->shadow_x > 0) pad_r += style->shadow_x; else pad_l -= style->shadow_x;
+	if (style->shadow_y > 0) pad_b += style->shadow_y; else pad_t -= style->shadow_y;
+	
+	w = text_w + pad_l + pad_r;
+	h = line_skip * (n_lines - 1) + height + pad_t + pad_b;
+	
+	dist = (float *) malloc (sizeof (float) * w * h);
+	if (dist == NULL) return NULL;
+	
+	for (x = 0; x < w * h; x++) dist[x] = 0.0f;
+	
+	/* Juntar las distancias de todos los glifos, el máximo es la unión */
+	line = text;
+	line_n = 0;
+	while (line != NULL) {
+		pen_x = pad_l + (text_w - sdf_line_width (font, line, style->size)) / 2.0;
+		
+		while (*line != '\0' && *line != '\n') {
+			ch = sdf_utf8_next (&line);
+			if (ch < 0 || !font->glyphs[ch - SDF_FIRST_CHAR].provided) ch = ' ';
+			glyph = &font->glyphs[ch - SDF_FIRST_CHAR];
+			
+			if (glyph->w > 0) {
+				x0 = pen_x - SDF_SPREAD * scale;
+				y0 = pad_t + line_n * line_skip - SDF_SPREAD * scale;
+				
+				xs = (int) floor (x0); if (xs < 0) xs = 0;
+				ys = (int) floor (y0); if (ys < 0) ys = 0;
+				xe = (int) ceil (x0 + glyph->w * scale); if (xe > w) xe = w;
+				ye = (int) ceil (y0 + glyph->h * scale); if (ye > h) ye = h;
+				
+				for (y = ys; y < ye; y++) {
+					v = (y + 0.5 - y0) / scale - 0.5;
+					for (x = xs; x < xe; x++) {
+						u = (x + 0.5 - x0) / scale - 0.5;
+						d = sdf_sample (font, glyph, u, v);
+						if (d > dist[y * w + x]) dist[y * w + x] = d;
+					}
+				}
+			}
+			
+			pen_x += glyph->advance * scale;
+		}
+		
+		line = (*line == '\n') ? line + 1 : NULL;
+		line_n++;
+	}
+	
+	surface = SDL_CreateRGBSurface (SDL_SWSURFACE, w, h, 32, RMASK, GMASK, BMASK, AMASK);
+	if (surface == NULL) {
+		free (dist);
+		return NULL;
+	}
+	
+	/* Una sola pasada: relleno, contorno y sombra desde la misma distancia */
+	ds = SDF_SPREAD * scale / 127.0;
+	SDL_LockSurface (surface);
+	for (y = 0; y < h; y++) {
+		pixels = (Uint32 *) ((Uint8 *) surface->pixels + y * surface->pitch);
+		for (x = 0; x < w; x++) {
+			d = (dist[y * w + x] - 128.0) * ds;
+			
+			a_fill = sdf_clamp01 (0.5 + d);
+			a_outline = (style->outline > 0.0) ? sdf_clamp01 (0.5 + d + style->outline) : a_fill;
+			
+			/* Color premultiplicado, el relleno sobre el contorno */
+			r = style->fill.r * a_fill + style->outline_color.r * (a_outline - a_fill);
+			g = style->fill.g * a_fill + style->outline_color.g * (a_outline - a_fill);
+			b = style->fill.b * a_fill + style->outline_color.b * (a_outline - a_fill);
+			a = a_outline;
+			
+			if (style->shadow_x != 0 || style->shadow_y != 0) {
+				xs = x - style->shadow_x;
+				ys = y - style->shadow_y;
+				
+				a_shadow = 0.0;
+				if (xs >= 0 && ys >= 0 && xs < w && ys < h) {
+					a_shadow = sdf_clamp01 (0.5 + (dist[ys * w + xs] - 128.0) * ds + style->outline);
+				}
+				
+				a_shadow = a_shadow * (1.0 - a);
+				r += style->shadow_color.r * a_shadow;
+				g += style->shadow_color.g * a_shadow;
+				b += style->shadow_color.b * a_shadow;
+				a += a_shadow;
+			}
+			
+			if (a > 0.0) {
+				r = r / a; g = g / a; b = b / a;
+			}
+			
+			pixels[x] = SDL_MapRGBA (surface->format, (Uint8) (r + 0.5), (Uint8) (g + 0.5), (Uint8) (b + 0.5), (Uint8) (a * 255.0 + 0.5));
+		}
+	}
+	SDL_UnlockSurface (surface);
+	
+	free (dist);
+	
+	return surface;
+}
+
+SDL_Surface * sdf_draw_text (SDFFont *font, double size, const char *text, SDL_Color color) {
+	SDFStyle style;
+	
+	memset (&style, 0, sizeof (style));
+	style.size = size;
+	style.fill = color;
+	
+	return sdf_render (font, text, &style);
+}
+
+/* El equivalente a draw_text_with_shadow: contorno del color de fondo */
+SDL_Surface * sdf_draw_text_with_shadow (SDFFont *font, double size, double outline, const char *text, SDL_Color foreground, SDL_Color background) {
+	SDFStyle style;
+	
+	memset (&style, 0, sizeof (style));
+	style.size = size;
+	style.fill = foreground;
+	style.outline = outline;
+	style.outline_color = background;
+	
+	return sdf_render (font, text, &style);
+}
+
@@ -0,0 +1,55 @@
+/*
+ * sdf-text.h
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef __SDF_TEXT_H__
+#define __SDF_TEXT_H__
+
+#include <SDL.h>
+
+typedef struct _SDFFont SDFFont;
+
+typedef struct {
+	double size;
+	SDL_Color fill;
+	
+	/* Grosor del contorno en pixeles, 0 para no dibujarlo */
+	double outline;
+	SDL_Color outline_color;
+	
+	/* La sombra tiene la forma del contorno, desplazada */
+	int shadow_x, shadow_y;
+	SDL_Color shadow_color;
+} SDFStyle;
+
+SDFFont * sdf_font_new (const char *filename);
+void sdf_font_free (SDFFont *font);
+
+double sdf_glyph_advance (SDFFont *font, int ch, double size);
+int sdf_text_width (SDFFont *font, const char *text, double size);
+int sdf_line_skip (SDFFont *font, double size);
+
+SDL_Surface * sdf_render (SDFFont *font, const char *text, const SDFStyle *style);
+SDL_Surface * sdf_draw_text (SDFFont *font, double size, const char *text, SDL_Color color);
+SDL_Surface * sdf_draw_text_with_shadow (SDFFont *font, double size, double outline, const char *text, SDL_Color foreground, SDL_Color background);
+
+#endif /* __SDF_TEXT_H__ */
+
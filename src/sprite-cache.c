@@ -0,0 +1,111 @@
+/*
+ * sprite-cache.c
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <stdlib.h>
+
+#include <SDL.h>
+
+#include "sprite-cache.h"
+#include "zoom.h"
+#include "trace.h"
+
+/*
+ * Imágenes escaladas que se reutilizan.
+ *
+ * Cada entrada se identifica por la imagen original, la escala y si se
+ * suavizó. La primera petición hace el escalado y las siguientes devuelven
+ * la misma superficie, que pertenece al cache: quien la pide no debe
+ * liberarla. Si la imagen original cambia o se libera hay que llamar a
+ * sprite_cache_forget para no devolver una copia vieja.
+ */
+
+typedef struct _SpriteEntry {
+	SDL_Surface *src;
+	double scale;
+	int smooth;
+	SDL_Surface *scaled;
+	
+	struct _SpriteEntry *next;
+} SpriteEntry;
+
+static SpriteEntry *sprite_entries = NULL;
+
+SDL_Surface * sprite_cache_get (SDL_Surface *src, double scale, int smooth) {
+	SpriteEntry *e;
+	SDL_Surface *scaled;
+	
+	if (src == NULL) return NULL;
+	
+	for (e = sprite_entries; e != NULL; e = e->next) {
+		if (e->src == src && e->scale == scale && e->smooth == smooth) {
+			return e->scaled;
+		}
+	}
+	
+	TRACE_BEGIN ("zoom");
+	scaled = zoomSurface (src, scale, scale, smooth);
+	TRACE_END ("zoom");
+	if (scaled == NULL) return NULL;
+	
+	e = (SpriteEntry *) malloc (sizeof (SpriteEntry));
+	if (e == NULL) {
+		SDL_FreeSurface (scaled);
+		return NULL;
+	}
+	
+	e->src = src;
+	e->scale = scale;
+	e->smooth = smooth;
+	e->scaled = scaled;
+	e->next = sprite_entries;
+	sprite_entries = e;
+	
+	return scaled;
+}
+
+void sprite_cache_forget (SDL_Surface *src) {
+	SpriteEntry **p, *e;
+	
+	p = &sprite_entries;
+	while (*p != NULL) {
+		e = *p;
+		if (e->src == src) {
+			*p = e->next;
+			SDL_FreeSurface (e->scaled);
+			free (e);
+		} else {
+			p = &e->next;
+		}
+	}
+}
+
+void sprite_cache_flush (void) {
+	SpriteEntry *e;
+	
+	while (sprite_entries != NULL) {
+		e = sprite_entries;
+		sprite_entries = e->next;
+		SDL_FreeSurface (e->scaled);
+		free (e);
+	}
+}
+
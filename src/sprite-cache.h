@@ -0,0 +1,33 @@
+/*
+ * sprite-cache.h
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef __SPRITE_CACHE_H__
+#define __SPRITE_CACHE_H__
+
+#include <SDL.h>
+
+SDL_Surface * sprite_cache_get (SDL_Surface *src, double scale, int smooth);
+void sprite_cache_forget (SDL_Surface *src);
+void sprite_cache_flush (void);
+
+#endif /* __SPRITE_CACHE_H__ */
+
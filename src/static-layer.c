@@ -0,0 +1,173 @@
+/*
+ * static-layer.c
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL.h>
+
+#include "static-layer.h"
+#include "sdl2_rect.h"
+
+/*
+ * Capa con lo que no cambia de un cuadro a otro.
+ *
+ * Las imágenes de entrada se componen una sola vez, en orden de ranura, en
+ * una superficie con el formato de la pantalla. Cada cuadro empieza copiando
+ * esa superficie completa, que es una copia de memoria en lugar de varias
+ * mezclas con alfa. La capa se vuelve a componer sólo cuando cambia alguna
+ * entrada (otra superficie u otra posición) o cuando se invalida a mano
+ * porque el contenido de una entrada cambió. static_layer_draw_rect copia
+ * sólo una región, para quien redibuja únicamente lo que cambió.
+ */
+
+typedef struct {
+	SDL_Surface *surface;
+	int x, y;
+} StaticLayerInput;
+
+struct _StaticLayer {
+	SDL_Surface *surface;
+	StaticLayerInput inputs[STATIC_LAYER_MAX_INPUTS];
+	int dirty;
+};
+
+StaticLayer * static_layer_new (SDL_Surface *screen) {
+	StaticLayer *layer;
+	SDL_PixelFormat *fmt = screen->format;
+	
+	layer = (StaticLayer *) malloc (sizeof (StaticLayer));
+	if (layer == NULL) return NULL;
+	
+	memset (layer->inputs, 0, sizeof (layer->inputs));
+	layer->dirty = 1;
+	
+	/* Sin alfa, para que copiarla sea una copia directa */
+	layer->surface = SDL_CreateRGBSurface (SDL_SWSURFACE, screen->w, screen->h, fmt->BitsPerPixel, fmt->Rmask, fmt->Gmask, fmt->Bmask, 0);
+	if (layer->surface == NULL) {
+		free (layer);
+		return NULL;
+	}
+	
+	return layer;
+}
+
+void static_layer_free (StaticLayer *layer) {
+	if (layer == NULL) return;
+	
+	SDL_FreeSurface (layer->surface);
+	free (layer);
+}
+
+void static_layer_set (StaticLayer *layer, int slot, SDL_Surface *surface, int x, int y) {
+	StaticLayerInput *input;
+	
+	if (slot < 0 || slot >= STATIC_LAYER_MAX_INPUTS) return;
+	
+	input = &layer->inputs[slot];
+	if (input->surface == surface && input->x == x && input->y == y) return;
+	
+	input->surface = surface;
+	input->x = x;
+	input->y = y;
+	layer->dirty = 1;
+}
+
+void static_layer_invalidate (StaticLayer *layer) {
+	layer->dirty = 1;
+}
+
+static void static_layer_compose (StaticLayer *layer) {
+	SDL_Rect rect;
+	int g;
+	
+	SDL_FillRect (layer->surface, NULL, 0);
+	
+	for (g = 0; g < STATIC_LAYER_MAX_INPUTS; g++) {
+		if (layer->inputs[g].surface == NULL) continue;
+		
+		rect.x = layer->inputs[g].x;
+		rect.y = layer->inputs[g].y;
+		rect.w = layer->inputs[g].surface->w;
+		rect.h = layer->inputs[g].surface->h;
+		
+		SDL_BlitSurface (layer->inputs[g].surface, NULL, layer->surface, &rect);
+	}
+	
+	layer->dirty = 0;
+}
+
+int static_layer_update (StaticLayer *layer) {
+	if (!layer->dirty) return 0;
+	
+	static_layer_compose (layer);
+	
+	return 1;
+}
+
+void static_layer_draw_rect (StaticLayer *layer, SDL_Surface *dst, SDL_Rect *rect) {
+	SDL_Surface *src;
+	SDL_Rect area, whole;
+	Uint8 *s, *d;
+	int y, len, bpp;
+	
+	static_layer_update (layer);
+	
+	src = layer->surface;
+	whole.x = whole.y = 0;
+	whole.w = src->w;
+	whole.h = src->h;
+	
+	if (rect == NULL) {
+		area = whole;
+	} else if (!SDL_IntersectRect (rect, &whole, &area)) {
+		return;
+	}
+	
+	if (dst->w != src->w || dst->h != src->h || dst->format->BitsPerPixel != src->format->BitsPerPixel || dst->format->Rmask != src->format->Rmask) {
+		whole = area;
+		SDL_BlitSurface (src, &area, dst, &whole);
+		return;
+	}
+	
+	if (SDL_MUSTLOCK (dst)) SDL_LockSurface (dst);
+	
+	bpp = src->format->BytesPerPixel;
+	s = (Uint8 *) src->pixels + area.y * src->pitch + area.x * bpp;
+	d = (Uint8 *) dst->pixels + area.y * dst->pitch + area.x * bpp;
+	len = area.w * bpp;
+	
+	if (src->pitch == dst->pitch && area.x == 0 && area.w == src->w) {
+		memcpy (d, s, src->pitch * area.h);
+	} else {
+		for (y = 0; y < area.h; y++) {
+			memcpy (d + y * dst->pitch, s + y * src->pitch, len);
+		}
+	}
+	
+	if (SDL_MUSTLOCK (dst)) SDL_UnlockSurface (dst);
+}
+
+void static_layer_draw (StaticLayer *layer, SDL_Surface *dst) {
+	static_layer_draw_rect (layer, dst, NULL);
+}
+
@@ -0,0 +1,41 @@
+/*
+ * static-layer.h
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef __STATIC_LAYER_H__
+#define __STATIC_LAYER_H__
+
+#include <SDL.h>
+
+#define STATIC_LAYER_MAX_INPUTS 8
+
+typedef struct _StaticLayer StaticLayer;
+
+StaticLayer * static_layer_new (SDL_Surface *screen);
+void static_layer_free (StaticLayer *layer);
+void static_layer_set (StaticLayer *layer, int slot, SDL_Surface *surface, int x, int y);
+void static_layer_invalidate (StaticLayer *layer);
+int static_layer_update (StaticLayer *layer);
+void static_layer_draw (StaticLayer *layer, SDL_Surface *dst);
+void static_layer_draw_rect (StaticLayer *layer, SDL_Surface *dst, SDL_Rect *rect);
+
+#endif /* __STATIC_LAYER_H__ */
+
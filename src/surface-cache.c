@@ -0,0 +1,324 @@
+/*
+ * surface-cache.c
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <SDL.h>
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+#ifndef __MINGW32__
+#include <sys/mman.h>
+#endif
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+#include "surface-cache.h"
+
+/*
+ * Archivo de caché de superficies ya procesadas.
+ *
+ * El formato es crudo, en el orden de bytes de la máquina, para que se pueda
+ * mapear a memoria y usar los pixeles directamente sin copiarlos:
+ *
+ *   Cabecera
+ *   count x Entrada (tamaño, formato y desplazamiento de los pixeles)
+ *   Pixeles de cada superficie, alineados a 16 bytes
+ *
+ * La llave la decide quien usa la caché (por ejemplo, un hash de los archivos
+ * de origen), si no coincide el archivo se considera viejo.
+ */
+
+#define SURFACE_CACHE_MAGIC 0x43534342 /* "BCSC" */
+#define SURFACE_CACHE_VERSION 1
+#define SURFACE_CACHE_ENDIAN 0x01020304
+
+typedef struct {
+	Uint32 magic;
+	Uint32 version;
+	Uint32 endian;
+	Uint32 count;
+	Uint64 key;
+} SurfaceCacheHeader;
+
+typedef struct {
+	Uint32 w, h;
+	Uint32 pitch;
+	Uint32 bpp;
+	Uint32 Rmask, Gmask, Bmask, Amask;
+	Uint32 flags;
+	Uint32 offset;
+} SurfaceCacheEntry;
+
+struct _SurfaceCache {
+	void *data;
+	size_t size;
+	int mapped;
+};
+
+#define ALIGN_16(x) (((x) + 15) & ~15)
+
+/* FNV-1a de 64 bits */
+Uint64 surface_cache_hash (Uint64 hash, const void *data, int len) {
+	const Uint8 *p = (const Uint8 *) data;
+	int g;
+	
+	for (g = 0; g < len; g++) {
+		hash ^= p[g];
+		hash *= 0x100000001b3ULL;
+	}
+	
+	return hash;
+}
+
+int surface_cache_hash_file (Uint64 *hash, const char *filename) {
+	int fd, res;
+	Uint8 buffer[16384];
+	
+	fd = open (filename, O_RDONLY | O_BINARY);
+	if (fd < 0) return -1;
+	
+	while ((res = read (fd, buffer, sizeof (buffer))) > 0) {
+		*hash = surface_cache_hash (*hash, buffer, res);
+	}
+	
+	close (fd);
+	
+	return (res < 0) ? -1 : 0;
+}
+
+static int surface_cache_read_all (int fd, void *data, size_t size) {
+	size_t done = 0;
+	int res;
+	
+	while (done < size) {
+		res = read (fd, (Uint8 *) data + done, size - done);
+		if (res <= 0) return -1;
+		done += res;
+	}
+	
+	return 0;
+}
+
+SurfaceCache * surface_cache_load (const char *filename, Uint64 key, SDL_Surface **surfaces, int count) {
+	int fd, g;
+	struct stat st;
+	SurfaceCache *cache;
+	SurfaceCacheHeader *header;
+	SurfaceCacheEntry *entries;
+	
+	fd = open (filename, O_RDONLY | O_BINARY);
+	if (fd < 0) return NULL;
+	
+	if (fstat (fd, &st) < 0 || st.st_size < sizeof (SurfaceCacheHeader)) {
+		close (fd);
+		return NULL;
+	}
+	
+	cache = (SurfaceCache *) malloc (sizeof (SurfaceCache));
+	if (cache == NULL) {
+		close (fd);
+		return NULL;
+	}
+	
+	cache->size = st.st_size;
+	cache->mapped = 0;
+	cache->data = NULL;
+	
+#ifndef __MINGW32__
+	/* Privado, los pixeles se pueden modificar sin tocar el archivo */
+	cache->data = mmap (NULL, cache->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	if (cache->data == MAP_FAILED) {
+		cache->data = NULL;
+	} else {
+		cache->mapped = 1;
+	}
+#endif
+	if (cache->data == NULL) {
+		cache->data = malloc (cache->size);
+		
+		if (cache->data == NULL || surface_cache_read_all (fd, cache->data, cache->size) < 0) {
+			free (cache->data);
+			free (cache);
+			close (fd);
+			return NULL;
+		}
+	}
+	
+	close (fd);
+	
+	/* Validar la cabecera */
+	header = (SurfaceCacheHeader *) cache->data;
+	if (header->magic != SURFACE_CACHE_MAGIC || header->version != SURFACE_CACHE_VERSION ||
+	    header->endian != SURFACE_CACHE_ENDIAN || header->key != key || header->count != count ||
+	    sizeof (SurfaceCacheHeader) + count * sizeof (SurfaceCacheEntry) > cache->size) {
+		goto bad_cache;
+	}
+	
+	entries = (SurfaceCacheEntry *) ((Uint8 *) cache->data + sizeof (SurfaceCacheHeader));
+	
+	for (g = 0; g < count; g++) {
+		if ((entries[g].bpp != 8 && entries[g].bpp != 32) ||
+		    entries[g].pitch < entries[g].w * (entries[g].bpp / 8) ||
+		    (size_t) entries[g].offset + (size_t) entries[g].pitch * entries[g].h > cache->size) {
+			goto bad_cache;
+		}
+	}
+	
+	for (g = 0; g < count; g++) {
+		surfaces[g] = SDL_CreateRGBSurfaceFrom ((Uint8 *) cache->data + entries[g].offset,
+		               entries[g].w, entries[g].h, entries[g].bpp, entries[g].pitch,
+		               entries[g].Rmask, entries[g].Gmask, entries[g].Bmask, entries[g].Amask);
+		
+		if (surfaces[g] == NULL) {
+			while (--g >= 0) {
+				SDL_FreeSurface (surfaces[g]);
+				surfaces[g] = NULL;
+			}
+			goto bad_cache;
+		}
+		
+		if (entries[g].bpp == 32) {
+			SDL_SetAlpha (surfaces[g], entries[g].flags & SDL_SRCALPHA, SDL_ALPHA_OPAQUE);
+		}
+	}
+	
+	return cache;
+	
+bad_cache:
+	surface_cache_close (cache);
+	
+	return NULL;
+}
+
+/* Solo se debe cerrar cuando ya se liberaron las superficies que apuntan a la caché */
+void surface_cache_close (SurfaceCache *cache) {
+	if (cache == NULL) return;
+	
+#ifndef __MINGW32__
+	if (cache->mapped) {
+		munmap (cache->data, cache->size);
+	} else
+#endif
+	{
+		free (cache->data);
+	}
+	
+	free (cache);
+}
+
+int surface_cache_save (const char *filename, Uint64 key, SDL_Surface **surfaces, int count) {
+	SurfaceCacheHeader header;
+	SurfaceCacheEntry *entries;
+	char temp_name[8192];
+	Uint8 zeros[16];
+	FILE *f;
+	Uint32 offset;
+	int g, h, row, ok;
+	
+	entries = (SurfaceCacheEntry *) malloc (sizeof (SurfaceCacheEntry) * count);
+	if (entries == NULL) return -1;
+	
+	header.magic = SURFACE_CACHE_MAGIC;
+	header.version = SURFACE_CACHE_VERSION;
+	header.endian = SURFACE_CACHE_ENDIAN;
+	header.count = count;
+	header.key = key;
+	
+	offset = ALIGN_16 (sizeof (SurfaceCacheHeader) + count * sizeof (SurfaceCacheEntry));
+	for (g = 0; g < count; g++) {
+		if (surfaces[g]->format->BitsPerPixel != 8 && surfaces[g]->format->BitsPerPixel != 32) {
+			free (entries);
+			return -1;
+		}
+		entries[g].w = surfaces[g]->w;
+		entries[g].h = surfaces[g]->h;
+		entries[g].bpp = surfaces[g]->format->BitsPerPixel;
+		entries[g].pitch = ALIGN_16 (surfaces[g]->w * surfaces[g]->format->BytesPerPixel);
+		entries[g].Rmask = surfaces[g]->format->Rmask;
+		entries[g].Gmask = surfaces[g]->format->Gmask;
+		entries[g].Bmask = surfaces[g]->format->Bmask;
+		entries[g].Amask = surfaces[g]->format->Amask;
+		entries[g].flags = surfaces[g]->flags & SDL_SRCALPHA;
+		entries[g].offset = offset;
+		
+		offset += entries[g].pitch * entries[g].h;
+	}
+	
+	/* Escribir a un temporal y renombrar, para que nunca quede un archivo a medias */
+	snprintf (temp_name, sizeof (temp_name), "%s.tmp", filename);
+	f = fopen (temp_name, "wb");
+	if (f == NULL) {
+		free (entries);
+		return -1;
+	}
+	
+	memset (zeros, 0, sizeof (zeros));
+	ok = (fwrite (&header, sizeof (header), 1, f) == 1);
+	ok = ok && (fwrite (entries, sizeof (SurfaceCacheEntry), count, f) == count);
+	
+	offset = sizeof (SurfaceCacheHeader) + count * sizeof (SurfaceCacheEntry);
+	if (ok && ALIGN_16 (offset) != offset) {
+		ok = (fwrite (zeros, ALIGN_16 (offset) - offset, 1, f) == 1);
+	}
+	
+	for (g = 0; g < count && ok; g++) {
+		row = surfaces[g]->w * surfaces[g]->format->BytesPerPixel;
+		
+		if (SDL_MUSTLOCK (surfaces[g])) SDL_LockSurface (surfaces[g]);
+		for (h = 0; h < surfaces[g]->h && ok; h++) {
+			ok = (fwrite ((Uint8 *) surfaces[g]->pixels + h * surfaces[g]->pitch, row, 1, f) == 1);
+			if (ok && entries[g].pitch != row) {
+				ok = (fwrite (zeros, entries[g].pitch - row, 1, f) == 1);
+			}
+		}
+		if (SDL_MUSTLOCK (surfaces[g])) SDL_UnlockSurface (surfaces[g]);
+	}
+	
+	free (entries);
+	
+	if (fclose (f) != 0) ok = 0;
+	
+	if (!ok) {
+		unlink (temp_name);
+		return -1;
+	}
+	
+#ifdef __MINGW32__
+	/* En Windows, rename no reemplaza archivos existentes */
+	unlink (filename);
+#endif
+	if (rename (temp_name, filename) != 0) {
+		unlink (temp_name);
+		return -1;
+	}
+	
+	return 0;
+}
+
@@ -0,0 +1,40 @@
+/*
+ * surface-cache.h
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef __SURFACE_CACHE_H__
+#define __SURFACE_CACHE_H__
+
+#include <SDL.h>
+
+typedef struct _SurfaceCache SurfaceCache;
+
+#define SURFACE_CACHE_HASH_INIT 0xcbf29ce484222325ULL
+
+Uint64 surface_cache_hash (Uint64 hash, const void *data, int len);
+int surface_cache_hash_file (Uint64 *hash, const char *filename);
+
+SurfaceCache * surface_cache_load (const char *filename, Uint64 key, SDL_Surface **surfaces, int count);
+void surface_cache_close (SurfaceCache *cache);
+int surface_cache_save (const char *filename, Uint64 key, SDL_Surface **surfaces, int count);
+
+#endif /* __SURFACE_CACHE_H__ */
+
@@ -0,0 +1,104 @@
+/*
+ * text-cache.c
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <SDL.h>
+
+#include "path.h"
+#include "surface-cache.h"
+#include "text-cache.h"
+
+/*
+ * Caché en disco de los textos ya renderizados.
+ *
+ * Cada texto va en su propio archivo, con una llave que mezcla el idioma,
+ * el contenido de las fuentes, la cadena ya traducida y el estilo. Si algo
+ * cambia, la llave ya no coincide y el texto se vuelve a renderizar.
+ *
+ * Los archivos se quedan mapeados mientras el juego corre, porque las
+ * superficies usan sus pixeles directamente.
+ */
+
+#define TEXT_CACHE_VERSION 1
+
+static Uint64 text_cache_base = 0;
+static int text_cache_ready = 0;
+
+void text_cache_init (const char *locale, const char **font_files, int n_fonts) {
+	Uint32 version = TEXT_CACHE_VERSION;
+	int g;
+	
+	text_cache_ready = 0;
+	if (get_cache_path () == NULL) return;
+	
+	text_cache_base = surface_cache_hash (SURFACE_CACHE_HASH_INIT, &version, sizeof (version));
+	if (locale != NULL) {
+		text_cache_base = surface_cache_hash (text_cache_base, locale, strlen (locale));
+	}
+	
+	for (g = 0; g < n_fonts; g++) {
+		if (surface_cache_hash_file (&text_cache_base, font_files[g]) < 0) return;
+	}
+	
+	text_cache_ready = 1;
+}
+
+Uint64 text_cache_key (const char *text, const void *style, int style_len) {
+	Uint64 key;
+	
+	key = surface_cache_hash (text_cache_base, text, strlen (text) + 1);
+	key = surface_cache_hash (key, style, style_len);
+	
+	return key;
+}
+
+static void text_cache_filename (Uint64 key, char *buffer, int size) {
+	snprintf (buffer, size, "%stext-%08x%08x.cache", get_cache_path (), (unsigned int) (key >> 32), (unsigned int) (key & 0xFFFFFFFF));
+}
+
+/* Regresa 1 si las superficies se cargaron de la caché */
+int text_cache_get (Uint64 key, SDL_Surface **surfaces, int count) {
+	char buffer_file[8192];
+	
+	if (!text_cache_ready) return 0;
+	
+	text_cache_filename (key, buffer_file, sizeof (buffer_file));
+	
+	return (surface_cache_load (buffer_file, key, surfaces, count) != NULL);
+}
+
+void text_cache_put (Uint64 key, SDL_Surface **surfaces, int count) {
+	char buffer_file[8192];
+	
+	if (!text_cache_ready) return;
+	
+	if (!folder_create (get_cache_path ())) return;
+	
+	text_cache_filename (key, buffer_file, sizeof (buffer_file));
+	if (surface_cache_save (buffer_file, key, surfaces, count) < 0) {
+		fprintf (stderr, "Warning: Can't write the text cache file %s\n", buffer_file);
+	}
+}
+
@@ -0,0 +1,61 @@
+/*
+ * timing.c
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <SDL.h>
+
+#ifdef __MINGW32__
+#include <windows.h>
+#elif defined (MACOSX)
+#include <sys/time.h>
+#else
+#include <time.h>
+#endif
+
+#include "timing.h"
+
+Uint64 timing_now_us (void) {
+#ifdef __MINGW32__
+	static LARGE_INTEGER freq;
+	LARGE_INTEGER now;
+	
+	if (freq.QuadPart == 0) {
+		QueryPerformanceFrequency (&freq);
+	}
+	QueryPerformanceCounter (&now);
+	
+	return (Uint64) ((now.QuadPart / freq.QuadPart) * 1000000 + ((now.QuadPart % freq.QuadPart) * 1000000) / freq.QuadPart);
+#elif defined (MACOSX)
+	/* clock_gettime no existe en los Mac OS X viejos */
+	struct timeval tv;
+	
+	gettimeofday (&tv, NULL);
+	
+	return ((Uint64) tv.tv_sec) * 1000000 + tv.tv_usec;
+#else
+	struct timespec ts;
+	
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	
+	return ((Uint64) ts.tv_sec) * 1000000 + (ts.tv_nsec / 1000);
+#endif
+}
+
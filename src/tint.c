@@ -0,0 +1,110 @@
+/*
+ * tint.c
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <SDL.h>
+
+#include "tint.h"
+
+/*
+ * Recolorear una imagen sin volver a armarla.
+ *
+ * La imagen se compone una vez con el color negro (la base) y otra con el
+ * color blanco. La diferencia entre las dos es cuánto del color llega a cada
+ * pixel después de todas las mezclas, y se guarda en un canal de 8 bits.
+ * Para cualquier otro color basta con sumar a la base una tabla de 256
+ * entradas indexada por ese peso.
+ *
+ * Como las mezclas originales truncan, el resultado puede diferir en 1 de
+ * componer la imagen directamente con el color.
+ */
+
+SDL_Surface * tint_weight_new (SDL_Surface *black, SDL_Surface *white) {
+	SDL_Surface *weight;
+	SDL_PixelFormat *fmt;
+	Uint32 *pb, *pw;
+	Uint8 *w;
+	int x, y, dr, dg, db, min;
+	
+	if (black->format->BytesPerPixel != 4 || black->w != white->w || black->h != white->h) {
+		return NULL;
+	}
+	
+	weight = SDL_CreateRGBSurface (SDL_SWSURFACE, black->w, black->h, 8, 0, 0, 0, 0);
+	if (weight == NULL) return NULL;
+	
+	fmt = black->format;
+	for (y = 0; y < black->h; y++) {
+		pb = (Uint32 *) ((Uint8 *) black->pixels + y * black->pitch);
+		pw = (Uint32 *) ((Uint8 *) white->pixels + y * white->pitch);
+		w = (Uint8 *) weight->pixels + y * weight->pitch;
+		
+		for (x = 0; x < black->w; x++) {
+			dr = (int) ((pw[x] & fmt->Rmask) >> fmt->Rshift) - (int) ((pb[x] & fmt->Rmask) >> fmt->Rshift);
+			dg = (int) ((pw[x] & fmt->Gmask) >> fmt->Gshift) - (int) ((pb[x] & fmt->Gmask) >> fmt->Gshift);
+			db = (int) ((pw[x] & fmt->Bmask) >> fmt->Bshift) - (int) ((pb[x] & fmt->Bmask) >> fmt->Bshift);
+			
+			/* El menor de los tres, así la suma nunca se sale del canal */
+			min = dr;
+			if (dg < min) min = dg;
+			if (db < min) min = db;
+			if (min < 0) min = 0;
+			
+			w[x] = min;
+		}
+	}
+	
+	return weight;
+}
+
+int tint_apply (SDL_Surface *base, SDL_Surface *weight, SDL_Surface *dst, SDL_Color color) {
+	SDL_PixelFormat *fmt;
+	Uint32 lut[256];
+	Uint32 *pb, *pd;
+	Uint8 *w;
+	int x, y, g;
+	
+	if (base->format->BytesPerPixel != 4 || dst->format->BytesPerPixel != 4 ||
+	    base->w != dst->w || base->h != dst->h || base->w != weight->w || base->h != weight->h) {
+		return -1;
+	}
+	
+	fmt = base->format;
+	for (g = 0; g < 256; g++) {
+		lut[g] = (((color.r * g + 127) / 255) << fmt->Rshift) |
+		         (((color.g * g + 127) / 255) << fmt->Gshift) |
+		         (((color.b * g + 127) / 255) << fmt->Bshift);
+	}
+	
+	/* Una suma por pixel, la tabla ya trae los tres canales en su lugar */
+	for (y = 0; y < base->h; y++) {
+		pb = (Uint32 *) ((Uint8 *) base->pixels + y * base->pitch);
+		pd = (Uint32 *) ((Uint8 *) dst->pixels + y * dst->pitch);
+		w = (Uint8 *) weight->pixels + y * weight->pitch;
+		
+		for (x = 0; x < base->w; x++) {
+			pd[x] = pb[x] + lut[w[x]];
+		}
+	}
+	
+	return 0;
+}
+
@@ -0,0 +1,254 @@
+/*
+ * trace.c
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL.h>
+#include <SDL_thread.h>
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gettext.h"
+#define _(string) gettext (string)
+
+#include "trace.h"
+#include "timing.h"
+
+/*
+ * Trazas en el formato de Chrome (chrome://tracing o Perfetto).
+ *
+ * Cada hilo anota sus eventos en su propio anillo, que se crea la primera
+ * vez que el hilo traza algo. El hilo es el único que escribe en su anillo
+ * y el escritor el único que lee, así que basta con publicar los índices
+ * con barreras, sin candados. Si el anillo se llena se pierden eventos,
+ * nunca se detiene al hilo que traza.
+ *
+ * El escritor corre en su propio hilo y cada TRACE_FLUSH_MS pasa al archivo
+ * lo que haya en los anillos. El candado sólo protege la lista de anillos.
+ */
+
+/* Espacio que queda para los finales cuando el anillo se llena */
+#define TRACE_RING_RESERVE 64
+
+typedef struct {
+	Uint64 time;
+	const char *name;
+	char phase;
+} TraceEvent;
+
+typedef struct _TraceBuffer {
+	TraceEvent events[TRACE_RING_SIZE];
+	
+	/* head lo avanza el hilo que traza, tail el escritor */
+	unsigned int head, tail;
+	unsigned int dropped;
+	
+	int tid;
+	const char *thread_name;
+	int name_written;
+	
+	struct _TraceBuffer *next;
+} TraceBuffer;
+
+int trace_enabled = 0;
+
+static __thread TraceBuffer *trace_local = NULL;
+
+static TraceBuffer *trace_buffers = NULL;
+static int trace_n_buffers = 0;
+static SDL_mutex *trace_lock = NULL;
+static SDL_Thread *trace_writer = NULL;
+static FILE *trace_file = NULL;
+static Uint64 trace_start = 0;
+static int trace_quit = 0;
+static int trace_first = 1;
+
+static TraceBuffer * trace_register (void) {
+	TraceBuffer *buffer;
+	
+	buffer = (TraceBuffer *) malloc (sizeof (TraceBuffer));
+	if (buffer == NULL) return NULL;
+	
+	buffer->head = buffer->tail = 0;
+	buffer->dropped = 0;
+	buffer->thread_name = NULL;
+	buffer->name_written = 0;
+	
+	SDL_LockMutex (trace_lock);
+	buffer->tid = ++trace_n_buffers;
+	buffer->next = trace_buffers;
+	trace_buffers = buffer;
+	SDL_UnlockMutex (trace_lock);
+	
+	trace_local = buffer;
+	
+	return buffer;
+}
+
+void trace_event (char phase, const char *name) {
+	TraceBuffer *buffer = trace_local;
+	TraceEvent *ev;
+	unsigned int head, tail;
+	
+	if (buffer == NULL) {
+		buffer = trace_register ();
+		if (buffer == NULL) return;
+	}
+	
+	head = buffer->head;
+	tail = __atomic_load_n (&buffer->tail, __ATOMIC_ACQUIRE);
+	
+	/* Los inicios se pierden antes que los finales, para que no queden
+	 * rebanadas abiertas en el visor */
+	if (head - tail >= ((phase == 'B') ? TRACE_RING_SIZE - TRACE_RING_RESERVE : TRACE_RING_SIZE)) {
+		buffer->dropped++;
+		return;
+	}
+	
+	ev = &buffer->events[head % TRACE_RING_SIZE];
+	ev->time = timing_now_us ();
+	ev->name = name;
+	ev->phase = phase;
+	
+	__atomic_store_n (&buffer->head, head + 1, __ATOMIC_RELEASE);
+}
+
+/* Sólo sirve para que el visor muestre nombres en lugar de números */
+void trace_thread_name (const char *name) {
+	if (!trace_enabled) return;
+	
+	if (trace_local == NULL && trace_register () == NULL) return;
+	
+	SDL_LockMutex (trace_lock);
+	trace_local->thread_name = name;
+	SDL_UnlockMutex (trace_lock);
+}
+
+static void trace_separator (void) {
+	if (trace_first) {
+		trace_first = 0;
+	} else {
+		fputs (",\n", trace_file);
+	}
+}
+
+/* Pasar al archivo lo que haya en todos los anillos */
+static void trace_flush (void) {
+	TraceBuffer *buffer;
+	TraceEvent *ev;
+	unsigned int head, tail;
+	Uint64 ts;
+	
+	SDL_LockMutex (trace_lock);
+	for (buffer = trace_buffers; buffer != NULL; buffer = buffer->next) {
+		if (buffer->thread_name != NULL && !buffer->name_written) {
+			trace_separator ();
+			fprintf (trace_file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%i,\"args\":{\"name\":\"%s\"}}", buffer->tid, buffer->thread_name);
+			buffer->name_written = 1;
+		}
+		
+		head = __atomic_load_n (&buffer->head, __ATOMIC_ACQUIRE);
+		for (tail = buffer->tail; tail != head; tail++) {
+			ev = &buffer->events[tail % TRACE_RING_SIZE];
+			ts = (ev->time > trace_start) ? ev->time - trace_start : 0;
+			
+			trace_separator ();
+			fprintf (trace_file, "{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%llu,\"pid\":1,\"tid\":%i}", ev->name, ev->phase, (unsigned long long) ts, buffer->tid);
+		}
+		
+		__atomic_store_n (&buffer->tail, head, __ATOMIC_RELEASE);
+	}
+	SDL_UnlockMutex (trace_lock);
+}
+
+static int trace_writer_func (void *unused) {
+	while (!__atomic_load_n (&trace_quit, __ATOMIC_ACQUIRE)) {
+		SDL_Delay (TRACE_FLUSH_MS);
+		trace_flush ();
+	}
+	
+	return 0;
+}
+
+int trace_open (const char *filename) {
+	if (trace_file != NULL) return 0;
+	
+	trace_file = fopen (filename, "w");
+	if (trace_file == NULL) return -1;
+	
+	fputs ("{\"traceEvents\":[\n", trace_file);
+	
+	trace_lock = SDL_CreateMutex ();
+	trace_start = timing_now_us ();
+	trace_quit = 0;
+	trace_first = 1;
+	trace_enabled = 1;
+	
+	trace_thread_name ("Main");
+	
+	trace_writer = SDL_CreateThread (trace_writer_func, NULL);
+	
+	return 0;
+}
+
+/* Se llama cuando los demás hilos ya dejaron de trazar */
+void trace_close (void) {
+	TraceBuffer *buffer, *next;
+	unsigned int dropped = 0;
+	
+	if (trace_file == NULL) return;
+	
+	trace_enabled = 0;
+	
+	if (trace_writer != NULL) {
+		__atomic_store_n (&trace_quit, 1, __ATOMIC_RELEASE);
+		SDL_WaitThread (trace_writer, NULL);
+		trace_writer = NULL;
+	}
+	
+	/* Lo que quedó desde la última pasada del escritor */
+	trace_flush ();
+	
+	fputs ("\n]}\n", trace_file);
+	fclose (trace_file);
+	trace_file = NULL;
+	
+	for (buffer = trace_buffers; buffer != NULL; buffer = next) {
+		next = buffer->next;
+		dropped += buffer->dropped;
+		free (buffer);
+	}
+	trace_buffers = NULL;
+	trace_local = NULL;
+	
+	SDL_DestroyMutex (trace_lock);
+	trace_lock = NULL;
+	
+	if (dropped > 0) {
+		fprintf (stderr, _("Trace: %u events dropped, the ring buffers were full\n"), dropped);
+	}
+}
+
@@ -0,0 +1,46 @@
+/*
+ * trace.h
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <SDL.h>
+
+/* Eventos que guarda cada hilo antes de que el escritor los vacíe */
+#define TRACE_RING_SIZE 8192
+
+/* Cada cuánto el escritor vacía los anillos al archivo */
+#define TRACE_FLUSH_MS 50
+
+extern int trace_enabled;
+
+int trace_open (const char *filename);
+void trace_close (void);
+void trace_thread_name (const char *name);
+void trace_event (char phase, const char *name);
+
+/* Los nombres deben ser cadenas constantes, sólo se guarda el apuntador */
+#define TRACE_BEGIN(name) do { if (trace_enabled) trace_event ('B', name); } while (0)
+#define TRACE_END(name) do { if (trace_enabled) trace_event ('E', name); } while (0)
+
+#endif /* __TRACE_H__ */
+
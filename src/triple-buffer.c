@@ -0,0 +1,99 @@
+/*
+ * triple-buffer.c
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <stdlib.h>
+
+#include "triple-buffer.h"
+
+/*
+ * Intercambio de cuadros entre un hilo que escribe y uno que lee, sin
+ * candados.
+ *
+ * Hay tres espacios: el que llena el escritor (atrás), el que tiene el
+ * lector (al frente) y uno en medio. Publicar cambia atrás por el de en medio
+ * y lo marca como nuevo; leer cambia el del frente por el de en medio si hay
+ * algo nuevo. Ninguno de los dos espera al otro: el escritor nunca pisa lo
+ * que se está leyendo y el lector siempre toma lo más reciente, saltándose
+ * los cuadros que no alcanzó a ver.
+ *
+ * El índice de en medio y la marca de nuevo van en un solo entero que se
+ * cambia con una operación atómica.
+ */
+
+#define TRIPLE_BUFFER_FRESH 0x04
+#define TRIPLE_BUFFER_INDEX 0x03
+
+struct _TripleBuffer {
+	void *slots[3];
+	int back, front;
+	int middle;
+};
+
+TripleBuffer * triple_buffer_new (void *a, void *b, void *c) {
+	TripleBuffer *tb;
+	
+	tb = (TripleBuffer *) malloc (sizeof (TripleBuffer));
+	if (tb == NULL) return NULL;
+	
+	tb->slots[0] = a;
+	tb->slots[1] = b;
+	tb->slots[2] = c;
+	tb->back = 0;
+	tb->middle = 1;
+	tb->front = 2;
+	
+	return tb;
+}
+
+void triple_buffer_free (TripleBuffer *tb) {
+	free (tb);
+}
+
+/* Sólo el escritor */
+void * triple_buffer_back (TripleBuffer *tb) {
+	return tb->slots[tb->back];
+}
+
+/* Sólo el escritor */
+void triple_buffer_publish (TripleBuffer *tb) {
+	int prev;
+	
+	prev = __atomic_exchange_n (&tb->middle, tb->back | TRIPLE_BUFFER_FRESH, __ATOMIC_ACQ_REL);
+	tb->back = prev & TRIPLE_BUFFER_INDEX;
+}
+
+/* Sólo el lector, devuelve 1 si hay un cuadro nuevo en front */
+int triple_buffer_acquire (TripleBuffer *tb, void **front) {
+	int prev;
+	
+	if ((__atomic_load_n (&tb->middle, __ATOMIC_ACQUIRE) & TRIPLE_BUFFER_FRESH) == 0) {
+		*front = tb->slots[tb->front];
+		return 0;
+	}
+	
+	prev = __atomic_exchange_n (&tb->middle, tb->front, __ATOMIC_ACQ_REL);
+	tb->front = prev & TRIPLE_BUFFER_INDEX;
+	*front = tb->slots[tb->front];
+	
+	return 1;
+}
+
@@ -0,0 +1,35 @@
+/*
+ * triple-buffer.h
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef __TRIPLE_BUFFER_H__
+#define __TRIPLE_BUFFER_H__
+
+typedef struct _TripleBuffer TripleBuffer;
+
+TripleBuffer * triple_buffer_new (void *a, void *b, void *c);
+void triple_buffer_free (TripleBuffer *tb);
+void * triple_buffer_back (TripleBuffer *tb);
+void triple_buffer_publish (TripleBuffer *tb);
+int triple_buffer_acquire (TripleBuffer *tb, void **front);
+
+#endif /* __TRIPLE_BUFFER_H__ */
+
@@ -0,0 +1,275 @@
+/*
+ * watchdog.c
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <SDL.h>
+#include <SDL_thread.h>
+
+#include "watchdog.h"
+#include "timing.h"
+#include "path.h"
+
+/*
+ * Registro de cuadros que se pasan de su presupuesto.
+ *
+ * Se miden los pasos de la simulación y los cuadros del dibujante, cada
+ * uno contra su propio presupuesto, en el mismo registro.
+ *
+ * El hilo que mide sólo copia el cuadro a una cola y avisa; un hilo aparte
+ * le da formato y lo escribe, así que escribir al disco nunca detiene al
+ * juego. Si la cola se llena, el cuadro se cuenta como perdido.
+ *
+ * El archivo es watchdog.log en la carpeta de registros, y al pasar de
+ * WATCHDOG_LOG_MAX_BYTES se mueve a watchdog.log.1, y así.
+ */
+
+typedef struct {
+	WatchdogFrame frame;
+	time_t when;
+} WatchdogEntry;
+
+static const char *watchdog_phase_names[NUM_WATCHDOG_PHASES] = {
+	"input", "spawn", "update", "emit",
+	"events", "render", "present"
+};
+
+static const char *watchdog_kind_names[NUM_WATCHDOG_KINDS] = {
+	"step", "draw"
+};
+
+/* Las fases de cada tipo, de first a last */
+static const int watchdog_first_phase[NUM_WATCHDOG_KINDS] = {WATCHDOG_INPUT, WATCHDOG_EVENTS};
+static const int watchdog_last_phase[NUM_WATCHDOG_KINDS] = {WATCHDOG_EMIT, WATCHDOG_PRESENT};
+
+static int watchdog_enabled = 0;
+static Uint32 watchdog_budget[NUM_WATCHDOG_KINDS];
+
+static char *watchdog_filename = NULL;
+static FILE *watchdog_file = NULL;
+
+static WatchdogEntry watchdog_queue[WATCHDOG_QUEUE_SIZE];
+static int watchdog_head = 0, watchdog_count = 0;
+static unsigned int watchdog_dropped = 0;
+static int watchdog_quit = 0;
+
+static SDL_mutex *watchdog_lock = NULL;
+static SDL_cond *watchdog_pending = NULL;
+static SDL_Thread *watchdog_writer = NULL;
+
+/* watchdog.log.N-1 pasa a watchdog.log.N, y el actual a watchdog.log.1 */
+static void watchdog_rotate (void) {
+	char from[8192], to[8192];
+	int g;
+	
+	if (watchdog_file != NULL) {
+		fclose (watchdog_file);
+		watchdog_file = NULL;
+	}
+	
+	for (g = WATCHDOG_LOG_KEEP - 1; g > 0; g--) {
+		if (g == 1) {
+			snprintf (from, sizeof (from), "%s", watchdog_filename);
+		} else {
+			snprintf (from, sizeof (from), "%s.%i", watchdog_filename, g - 1);
+		}
+		snprintf (to, sizeof (to), "%s.%i", watchdog_filename, g);
+		
+		remove (to);
+		rename (from, to);
+	}
+	
+	watchdog_file = fopen (watchdog_filename, "w");
+}
+
+static void watchdog_write (const WatchdogEntry *entry) {
+	const WatchdogFrame *frame = &entry->frame;
+	char stamp[64];
+	int g;
+	
+	if (watchdog_file == NULL) return;
+	
+	strftime (stamp, sizeof (stamp), "%Y-%m-%d %H:%M:%S", localtime (&entry->when));
+	
+	fprintf (watchdog_file, "%s %s %u: %.2f ms (budget %.2f ms)", stamp, watchdog_kind_names[frame->kind], (unsigned int) frame->number, frame->total / 1000.0, watchdog_budget[frame->kind] / 1000.0);
+	for (g = watchdog_first_phase[frame->kind]; g <= watchdog_last_phase[frame->kind]; g++) {
+		fprintf (watchdog_file, " %s %.2f", watchdog_phase_names[g], frame->phases[g] / 1000.0);
+	}
+	
+	if (frame->kind == WATCHDOG_DRAW) {
+		fprintf (watchdog_file, " | items %i dirty rects %i\n", frame->items, frame->dirty);
+	} else {
+		fprintf (watchdog_file, " | objects %i level %i airborne %i bags %i\n", frame->objects, frame->level, frame->airbone, frame->bags);
+	}
+}
+
+static int watchdog_writer_func (void *unused) {
+	WatchdogEntry pending[WATCHDOG_QUEUE_SIZE];
+	unsigned int dropped;
+	int n, g, quit;
+	
+	do {
+		SDL_LockMutex (watchdog_lock);
+		while (watchdog_count == 0 && watchdog_dropped == 0 && !watchdog_quit) {
+			SDL_CondWait (watchdog_pending, watchdog_lock);
+		}
+		
+		n = watchdog_count;
+		for (g = 0; g < n; g++) {
+			pending[g] = watchdog_queue[(watchdog_head + g) % WATCHDOG_QUEUE_SIZE];
+		}
+		watchdog_head = (watchdog_head + n) % WATCHDOG_QUEUE_SIZE;
+		watchdog_count = 0;
+		dropped = watchdog_dropped;
+		watchdog_dropped = 0;
+		quit = watchdog_quit;
+		SDL_UnlockMutex (watchdog_lock);
+		
+		for (g = 0; g < n; g++) {
+			watchdog_write (&pending[g]);
+		}
+		
+		if (dropped > 0 && watchdog_file != NULL) {
+			fprintf (watchdog_file, "%u slow frames were not logged, the queue was full\n", dropped);
+		}
+		
+		if (watchdog_file != NULL) {
+			fflush (watchdog_file);
+			if (ftell (watchdog_file) > WATCHDOG_LOG_MAX_BYTES) watchdog_rotate ();
+		}
+	} while (!quit);
+	
+	return 0;
+}
+
+int watchdog_open (const char *dir, Uint32 step_budget_us, Uint32 draw_budget_us) {
+	if (watchdog_enabled) return 0;
+	if (dir == NULL || !folder_create (dir)) return -1;
+	
+	watchdog_filename = (char *) malloc (strlen (dir) + 16);
+	if (watchdog_filename == NULL) return -1;
+	sprintf (watchdog_filename, "%swatchdog.log", dir);
+	
+	watchdog_file = fopen (watchdog_filename, "a");
+	if (watchdog_file == NULL) {
+		free (watchdog_filename);
+		watchdog_filename = NULL;
+		return -1;
+	}
+	
+	fseek (watchdog_file, 0, SEEK_END);
+	if (ftell (watchdog_file) > WATCHDOG_LOG_MAX_BYTES) watchdog_rotate ();
+	
+	watchdog_budget[WATCHDOG_STEP] = step_budget_us;
+	watchdog_budget[WATCHDOG_DRAW] = draw_budget_us;
+	watchdog_head = watchdog_count = 0;
+	watchdog_dropped = 0;
+	watchdog_quit = 0;
+	
+	watchdog_lock = SDL_CreateMutex ();
+	watchdog_pending = SDL_CreateCond ();
+	watchdog_writer = SDL_CreateThread (watchdog_writer_func, NULL);
+	
+	if (watchdog_writer == NULL) {
+		SDL_DestroyCond (watchdog_pending);
+		SDL_DestroyMutex (watchdog_lock);
+		if (watchdog_file != NULL) fclose (watchdog_file);
+		watchdog_file = NULL;
+		return -1;
+	}
+	
+	watchdog_enabled = 1;
+	
+	return 0;
+}
+
+void watchdog_close (void) {
+	if (!watchdog_enabled) return;
+	
+	watchdog_enabled = 0;
+	
+	SDL_LockMutex (watchdog_lock);
+	watchdog_quit = 1;
+	SDL_CondSignal (watchdog_pending);
+	SDL_UnlockMutex (watchdog_lock);
+	
+	SDL_WaitThread (watchdog_writer, NULL);
+	watchdog_writer = NULL;
+	
+	if (watchdog_file != NULL) fclose (watchdog_file);
+	watchdog_file = NULL;
+	
+	SDL_DestroyCond (watchdog_pending);
+	SDL_DestroyMutex (watchdog_lock);
+	free (watchdog_filename);
+	watchdog_filename = NULL;
+}
+
+void watchdog_frame_start (WatchdogFrame *frame, int kind, Uint32 number) {
+	if (!watchdog_enabled) return;
+	
+	memset (frame, 0, sizeof (WatchdogFrame));
+	frame->kind = kind;
+	frame->number = number;
+	frame->start = frame->last = timing_now_us ();
+}
+
+/* Suma a la fase el tiempo desde la marca anterior */
+void watchdog_lap (WatchdogFrame *frame, int phase) {
+	Uint64 now;
+	
+	if (!watchdog_enabled) return;
+	
+	now = timing_now_us ();
+	frame->phases[phase] += now - frame->last;
+	frame->last = now;
+}
+
+int watchdog_frame_slow (WatchdogFrame *frame) {
+	if (!watchdog_enabled) return 0;
+	
+	frame->total = frame->last - frame->start;
+	
+	return (frame->total > watchdog_budget[frame->kind]);
+}
+
+void watchdog_report (const WatchdogFrame *frame) {
+	WatchdogEntry *entry;
+	
+	if (!watchdog_enabled) return;
+	
+	SDL_LockMutex (watchdog_lock);
+	if (watchdog_count < WATCHDOG_QUEUE_SIZE) {
+		entry = &watchdog_queue[(watchdog_head + watchdog_count) % WATCHDOG_QUEUE_SIZE];
+		entry->frame = *frame;
+		entry->when = time (NULL);
+		watchdog_count++;
+	} else {
+		watchdog_dropped++;
+	}
+	SDL_CondSignal (watchdog_pending);
+	SDL_UnlockMutex (watchdog_lock);
+}
+
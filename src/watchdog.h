@@ -0,0 +1,80 @@
+/*
+ * watchdog.h
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef __WATCHDOG_H__
+#define __WATCHDOG_H__
+
+#include <SDL.h>
+
+/* Cuadros lentos que pueden esperar al escritor */
+#define WATCHDOG_QUEUE_SIZE 64
+
+/* El registro rota al pasar de este tamaño, y se guardan WATCHDOG_LOG_KEEP */
+#define WATCHDOG_LOG_MAX_BYTES (512 * 1024)
+#define WATCHDOG_LOG_KEEP 3
+
+/* Qué hilo se mide, cada uno con su presupuesto */
+enum {
+	WATCHDOG_STEP = 0,
+	WATCHDOG_DRAW,
+	
+	NUM_WATCHDOG_KINDS
+};
+
+enum {
+	/* Paso de la simulación */
+	WATCHDOG_INPUT = 0,
+	WATCHDOG_SPAWN,
+	WATCHDOG_UPDATE,
+	WATCHDOG_EMIT,
+	
+	/* Cuadro del dibujante */
+	WATCHDOG_EVENTS,
+	WATCHDOG_RENDER,
+	WATCHDOG_PRESENT,
+	
+	NUM_WATCHDOG_PHASES
+};
+
+typedef struct {
+	int kind;
+	Uint32 number;
+	Uint64 start, last;
+	Uint64 phases[NUM_WATCHDOG_PHASES];
+	Uint64 total;
+	
+	/* El estado del juego en ese paso, lo llena quien llama */
+	int objects, level, airbone, bags;
+	
+	/* Lo que dibujó ese cuadro */
+	int items, dirty;
+} WatchdogFrame;
+
+int watchdog_open (const char *dir, Uint32 step_budget_us, Uint32 draw_budget_us);
+void watchdog_close (void);
+void watchdog_frame_start (WatchdogFrame *frame, int kind, Uint32 number);
+void watchdog_lap (WatchdogFrame *frame, int phase);
+int watchdog_frame_slow (WatchdogFrame *frame);
+void watchdog_report (const WatchdogFrame *frame);
+
+#endif /* __WATCHDOG_H__ */
+
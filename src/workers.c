@@ -0,0 +1,295 @@
+/*
+ * workers.c
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#include <stdlib.h>
+
+#include <SDL.h>
+#include <SDL_thread.h>
+
+#ifdef __MINGW32__
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "workers.h"
+#include "trace.h"
+
+/*
+ * Pequeño grupo de hilos para trabajos independientes (decodificar imágenes,
+ * bandas de un zoom, etc). Un lote son n elementos que se reparten entre los
+ * hilos. El hilo que espera un lote también procesa elementos, así que
+ * workers_run funciona aunque no haya hilos.
+ */
+
+struct _WorkerBatch {
+	WorkerFunc func;
+	void *data;
+	
+	int n_items;
+	int next_item;
+	int done_items;
+	
+	WorkerBatch *next;
+};
+
+static SDL_mutex *workers_lock = NULL;
+static SDL_cond *workers_pending = NULL;
+static SDL_cond *workers_finished = NULL;
+
+static WorkerBatch *workers_queue_first = NULL, *workers_queue_last = NULL;
+
+static SDL_Thread **workers_threads = NULL;
+static int workers_n = 0;
+static int workers_quit = 0;
+
+int workers_cpu_count (void) {
+	int n;
+#ifdef __MINGW32__
+	SYSTEM_INFO info;
+	
+	GetSystemInfo (&info);
+	n = info.dwNumberOfProcessors;
+#elif defined (_SC_NPROCESSORS_ONLN)
+	n = sysconf (_SC_NPROCESSORS_ONLN);
+#else
+	n = 1;
+#endif
+	if (n < 1) n = 1;
+	
+	return n;
+}
+
+/* Debe llamarse con el candado tomado */
+static void workers_unqueue (WorkerBatch *batch) {
+	WorkerBatch *prev, *p;
+	
+	prev = NULL;
+	for (p = workers_queue_first; p != NULL; p = p->next) {
+		if (p == batch) break;
+		prev = p;
+	}
+	
+	if (p == NULL) return;
+	
+	if (prev == NULL) {
+		workers_queue_first = p->next;
+	} else {
+		prev->next = p->next;
+	}
+	
+	if (workers_queue_last == p) {
+		workers_queue_last = prev;
+	}
+	
+	p->next = NULL;
+}
+
+/* Reclamar el siguiente elemento pendiente de la cola, con el candado tomado */
+static WorkerBatch * workers_claim (int *item) {
+	WorkerBatch *batch;
+	
+	batch = workers_queue_first;
+	if (batch == NULL) return NULL;
+	
+	*item = batch->next_item++;
+	
+	if (batch->next_item >= batch->n_items) {
+		/* Ya no quedan elementos por repartir de este lote */
+		workers_unqueue (batch);
+	}
+	
+	return batch;
+}
+
+static void workers_complete (WorkerBatch *batch) {
+	batch->done_items++;
+	
+	if (batch->done_items == batch->n_items) {
+		SDL_CondBroadcast (workers_finished);
+	}
+}
+
+static int workers_thread_func (void *unused) {
+	WorkerBatch *batch;
+	int item;
+	
+	trace_thread_name ("Worker");
+	
+	SDL_LockMutex (workers_lock);
+	while (1) {
+		batch = NULL;
+		while (!workers_quit && (batch = workers_claim (&item)) == NULL) {
+			SDL_CondWait (workers_pending, workers_lock);
+		}
+		
+		if (batch == NULL) break;
+		
+		SDL_UnlockMutex (workers_lock);
+		batch->func (batch->data, item);
+		SDL_LockMutex (workers_lock);
+		
+		workers_complete (batch);
+	}
+	SDL_UnlockMutex (workers_lock);
+	
+	return 0;
+}
+
+void workers_init (int n) {
+	int g;
+	
+	if (workers_lock != NULL) return;
+	
+	if (n <= 0) {
+		n = workers_cpu_count ();
+	}
+	
+	workers_lock = SDL_CreateMutex ();
+	workers_pending = SDL_CreateCond ();
+	workers_finished = SDL_CreateCond ();
+	workers_quit = 0;
+	
+	workers_threads = (SDL_Thread **) malloc (sizeof (SDL_Thread *) * n);
+	workers_n = 0;
+	
+	for (g = 0; g < n; g++) {
+		workers_threads[workers_n] = SDL_CreateThread (workers_thread_func, NULL);
+		
+		/* Si no se puede crear el hilo, se trabaja con los que haya */
+		if (workers_threads[workers_n] != NULL) workers_n++;
+	}
+}
+
+void workers_shutdown (void) {
+	int g;
+	
+	if (workers_lock == NULL) return;
+	
+	SDL_LockMutex (workers_lock);
+	workers_quit = 1;
+	SDL_CondBroadcast (workers_pending);
+	SDL_UnlockMutex (workers_lock);
+	
+	for (g = 0; g < workers_n; g++) {
+		SDL_WaitThread (workers_threads[g], NULL);
+	}
+	
+	free (workers_threads);
+	workers_threads = NULL;
+	workers_n = 0;
+	
+	SDL_DestroyCond (workers_pending);
+	SDL_DestroyCond (workers_finished);
+	SDL_DestroyMutex (workers_lock);
+	workers_lock = NULL;
+}
+
+int workers_count (void) {
+	return workers_n;
+}
+
+WorkerBatch * workers_batch_start (WorkerFunc func, void *data, int n_items) {
+	WorkerBatch *batch;
+	
+	/* Si nadie inicializó el grupo, se trabaja sin hilos */
+	if (workers_lock == NULL) workers_init (0);
+	
+	batch = (WorkerBatch *) malloc (sizeof (WorkerBatch));
+	
+	if (batch == NULL) return NULL;
+	
+	batch->func = func;
+	batch->data = data;
+	batch->n_items = n_items;
+	batch->next_item = 0;
+	batch->done_items = 0;
+	batch->next = NULL;
+	
+	if (n_items <= 0) return batch;
+	
+	SDL_LockMutex (workers_lock);
+	if (workers_queue_last == NULL) {
+		workers_queue_first = workers_queue_last = batch;
+	} else {
+		workers_queue_last->next = batch;
+		workers_queue_last = batch;
+	}
+	SDL_CondBroadcast (workers_pending);
+	SDL_UnlockMutex (workers_lock);
+	
+	return batch;
+}
+
+int workers_batch_progress (WorkerBatch *batch) {
+	int done;
+	
+	SDL_LockMutex (workers_lock);
+	done = batch->done_items;
+	SDL_UnlockMutex (workers_lock);
+	
+	return done;
+}
+
+void workers_batch_wait (WorkerBatch *batch) {
+	int item;
+	
+	if (batch == NULL) return;
+	
+	SDL_LockMutex (workers_lock);
+	
+	/* Ayudar con los elementos que aún no reclama nadie */
+	while (batch->next_item < batch->n_items) {
+		item = batch->next_item++;
+		if (batch->next_item >= batch->n_items) {
+			workers_unqueue (batch);
+		}
+		
+		SDL_UnlockMutex (workers_lock);
+		batch->func (batch->data, item);
+		SDL_LockMutex (workers_lock);
+		
+		workers_complete (batch);
+	}
+	
+	while (batch->done_items < batch->n_items) {
+		SDL_CondWait (workers_finished, workers_lock);
+	}
+	SDL_UnlockMutex (workers_lock);
+	
+	free (batch);
+}
+
+void workers_run (WorkerFunc func, void *data, int n_items) {
+	int g;
+	
+	if (n_items == 1 || workers_n == 0) {
+		/* No vale la pena despertar a los hilos */
+		for (g = 0; g < n_items; g++) {
+			func (data, g);
+		}
+		return;
+	}
+	
+	workers_batch_wait (workers_batch_start (func, data, n_items));
+}
+
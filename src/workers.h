@@ -0,0 +1,42 @@
+/*
+ * workers.h
+ * This file is part of Bean Counters Classic
+ *
+ * Copyright (C) 2018 - Félix Arreola Rodríguez
+ *
+ * Bean Counters Classic is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Bean Counters Classic is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Bean Counters Classic; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, 
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef __WORKERS_H__
+#define __WORKERS_H__
+
+/* Función que procesa un elemento de un lote */
+typedef void (*WorkerFunc) (void *data, int item);
+
+typedef struct _WorkerBatch WorkerBatch;
+
+int workers_cpu_count (void);
+void workers_init (int n);
+void workers_shutdown (void);
+int workers_count (void);
+
+WorkerBatch * workers_batch_start (WorkerFunc func, void *data, int n_items);
+int workers_batch_progress (WorkerBatch *batch);
+void workers_batch_wait (WorkerBatch *batch);
+void workers_run (WorkerFunc func, void *data, int n_items);
+
+#endif /* __WORKERS_H__ */
+
@@ -57,6 +57,14 @@ Andreas Schiffler -- aschiffler at ferzkopp dot net
 #include <math.h>
 #include <SDL.h>
 
+#if defined (__GNUC__) && (defined (__i386__) || defined (__x86_64__))
+#define ZOOM_HAVE_SIMD
+#include <immintrin.h>
+#endif
+
+#include "workers.h"
+#include "perf-counters.h"
+
 typedef struct tColorRGBA {
 	Uint8 r;
 	Uint8 g;
@@ -179,11 +187,252 @@ int _zoomSurfaceY(SDL_Surface * src, SDL_Surface * dst, int flipx, int flipy) {
 	return (0);
 }
 
+/*
+ * Zoom suavizado de 32 bits.
+ *
+ * Es la misma interpolación bilineal de la SDL_gfx, pero primero se calculan
+ * para cada columna los dos pixeles de origen y su peso, y para cada fila los
+ * dos renglones de origen. Así cada renglón de destino es independiente: se
+ * puede procesar con SSE2 o AVX2 (se elige al ejecutar según el procesador)
+ * y repartir en bandas entre los hilos de workers.c.
+ *
+ * Las versiones vectoriales hacen exactamente las mismas operaciones
+ * enteras, el resultado es idéntico bit a bit al código original. La resta
+ * (c01 - c00) * ex se hace como c01 * ex - c00 * ex con productos completos
+ * de 16x16 bits sin signo, que es la misma cantidad antes del corrimiento.
+ */
+
+/* Abajo de este tamaño no vale la pena repartir el trabajo */
+#define ZOOM_PARALLEL_PIXELS (128 * 1024)
+#define ZOOM_BAND_ROWS 16
+
+typedef void (*ZoomRowFunc) (const Uint32 *r0, const Uint32 *r1, const int *col0, const int *col1, const int *fx, int ey, Uint32 *d, int w);
+
+typedef struct {
+	SDL_Surface *src, *dst;
+	int *say;
+	int *col0, *col1, *fx;
+	int flipy;
+	ZoomRowFunc row;
+} ZoomJob;
+
+static void _zoomRowRGBA_C (const Uint32 *r0, const Uint32 *r1, const int *col0, const int *col1, const int *fx, int ey, Uint32 *d, int w) {
+	const tColorRGBA *c00, *c01, *c10, *c11;
+	tColorRGBA *dp;
+	int x, ex, t1, t2;
+	
+	dp = (tColorRGBA *) d;
+	for (x = 0; x < w; x++) {
+		c00 = (const tColorRGBA *) &r0[col0[x]];
+		c01 = (const tColorRGBA *) &r0[col1[x]];
+		c10 = (const tColorRGBA *) &r1[col0[x]];
+		c11 = (const tColorRGBA *) &r1[col1[x]];
+		ex = fx[x];
+		
+		t1 = ((((c01->r - c00->r) * ex) >> 16) + c00->r) & 0xff;
+		t2 = ((((c11->r - c10->r) * ex) >> 16) + c10->r) & 0xff;
+		dp->r = (((t2 - t1) * ey) >> 16) + t1;
+		t1 = ((((c01->g - c00->g) * ex) >> 16) + c00->g) & 0xff;
+		t2 = ((((c11->g - c10->g) * ex) >> 16) + c10->g) & 0xff;
+		dp->g = (((t2 - t1) * ey) >> 16) + t1;
+		t1 = ((((c01->b - c00->b) * ex) >> 16) + c00->b) & 0xff;
+		t2 = ((((c11->b - c10->b) * ex) >> 16) + c10->b) & 0xff;
+		dp->b = (((t2 - t1) * ey) >> 16) + t1;
+		t1 = ((((c01->a - c00->a) * ex) >> 16) + c00->a) & 0xff;
+		t2 = ((((c11->a - c10->a) * ex) >> 16) + c10->a) & 0xff;
+		dp->a = (((t2 - t1) * ey) >> 16) + t1;
+		dp++;
+	}
+}
+
+#ifdef ZOOM_HAVE_SIMD
+/* ((b - a) * e >> 16) + a con canales de 16 bits, en dos mitades de 32 */
+__attribute__ ((target ("sse2")))
+static inline __m128i _zoomLerpSSE2 (__m128i a, __m128i b, __m128i e) {
+	__m128i zero, alo, ahi, blo, bhi, lo, hi;
+	
+	zero = _mm_setzero_si128 ();
+	alo = _mm_mullo_epi16 (a, e);
+	ahi = _mm_mulhi_epu16 (a, e);
+	blo = _mm_mullo_epi16 (b, e);
+	bhi = _mm_mulhi_epu16 (b, e);
+	
+	lo = _mm_sub_epi32 (_mm_unpacklo_epi16 (blo, bhi), _mm_unpacklo_epi16 (alo, ahi));
+	hi = _mm_sub_epi32 (_mm_unpackhi_epi16 (blo, bhi), _mm_unpackhi_epi16 (alo, ahi));
+	lo = _mm_add_epi32 (_mm_srai_epi32 (lo, 16), _mm_unpacklo_epi16 (a, zero));
+	hi = _mm_add_epi32 (_mm_srai_epi32 (hi, 16), _mm_unpackhi_epi16 (a, zero));
+	
+	/* Los resultados quedan entre a y b, caben de nuevo en 16 bits */
+	return _mm_packs_epi32 (lo, hi);
+}
+
+__attribute__ ((target ("sse2")))
+static void _zoomRowRGBA_SSE2 (const Uint32 *r0, const Uint32 *r1, const int *col0, const int *col1, const int *fx, int ey, Uint32 *d, int w) {
+	__m128i zero, c00, c01, c10, c11, ex, vey, t1, t2;
+	int x;
+	
+	zero = _mm_setzero_si128 ();
+	vey = _mm_set1_epi16 ((short) ey);
+	
+	for (x = 0; x + 2 <= w; x += 2) {
+		c00 = _mm_unpacklo_epi8 (_mm_set_epi32 (0, 0, r0[col0[x + 1]], r0[col0[x]]), zero);
+		c01 = _mm_unpacklo_epi8 (_mm_set_epi32 (0, 0, r0[col1[x + 1]], r0[col1[x]]), zero);
+		c10 = _mm_unpacklo_epi8 (_mm_set_epi32 (0, 0, r1[col0[x + 1]], r1[col0[x]]), zero);
+		c11 = _mm_unpacklo_epi8 (_mm_set_epi32 (0, 0, r1[col1[x + 1]], r1[col1[x]]), zero);
+		ex = _mm_unpacklo_epi64 (_mm_set1_epi16 ((short) fx[x]), _mm_set1_epi16 ((short) fx[x + 1]));
+		
+		t1 = _zoomLerpSSE2 (c00, c01, ex);
+		t2 = _zoomLerpSSE2 (c10, c11, ex);
+		t1 = _zoomLerpSSE2 (t1, t2, vey);
+		
+		_mm_storel_epi64 ((__m128i *) &d[x], _mm_packus_epi16 (t1, t1));
+	}
+	
+	if (x < w) {
+		_zoomRowRGBA_C (r0, r1, col0 + x, col1 + x, fx + x, ey, d + x, w - x);
+	}
+}
+
+__attribute__ ((target ("avx2")))
+static inline __m256i _zoomLerpAVX2 (__m256i a, __m256i b, __m256i e) {
+	__m256i zero, alo, ahi, blo, bhi, lo, hi;
+	
+	zero = _mm256_setzero_si256 ();
+	alo = _mm256_mullo_epi16 (a, e);
+	ahi = _mm256_mulhi_epu16 (a, e);
+	blo = _mm256_mullo_epi16 (b, e);
+	bhi = _mm256_mulhi_epu16 (b, e);
+	
+	/* Los unpack y pack trabajan dentro de cada mitad, el orden se conserva */
+	lo = _mm256_sub_epi32 (_mm256_unpacklo_epi16 (blo, bhi), _mm256_unpacklo_epi16 (alo, ahi));
+	hi = _mm256_sub_epi32 (_mm256_unpackhi_epi16 (blo, bhi), _mm256_unpackhi_epi16 (alo, ahi));
+	lo = _mm256_add_epi32 (_mm256_srai_epi32 (lo, 16), _mm256_unpacklo_epi16 (a, zero));
+	hi = _mm256_add_epi32 (_mm256_srai_epi32 (hi, 16), _mm256_unpackhi_epi16 (a, zero));
+	
+	return _mm256_packs_epi32 (lo, hi);
+}
+
+__attribute__ ((target ("avx2")))
+static void _zoomRowRGBA_AVX2 (const Uint32 *r0, const Uint32 *r1, const int *col0, const int *col1, const int *fx, int ey, Uint32 *d, int w) {
+	__m256i c00, c01, c10, c11, ex, vey, t1, t2;
+	int x;
+	
+	vey = _mm256_set1_epi16 ((short) ey);
+	
+	for (x = 0; x + 4 <= w; x += 4) {
+		c00 = _mm256_cvtepu8_epi16 (_mm_set_epi32 (r0[col0[x + 3]], r0[col0[x + 2]], r0[col0[x + 1]], r0[col0[x]]));
+		c01 = _mm256_cvtepu8_epi16 (_mm_set_epi32 (r0[col1[x + 3]], r0[col1[x + 2]], r0[col1[x + 1]], r0[col1[x]]));
+		c10 = _mm256_cvtepu8_epi16 (_mm_set_epi32 (r1[col0[x + 3]], r1[col0[x + 2]], r1[col0[x + 1]], r1[col0[x]]));
+		c11 = _mm256_cvtepu8_epi16 (_mm_set_epi32 (r1[col1[x + 3]], r1[col1[x + 2]], r1[col1[x + 1]], r1[col1[x]]));
+		ex = _mm256_set_epi16 (fx[x + 3], fx[x + 3], fx[x + 3], fx[x + 3], fx[x + 2], fx[x + 2], fx[x + 2], fx[x + 2],
+		                       fx[x + 1], fx[x + 1], fx[x + 1], fx[x + 1], fx[x], fx[x], fx[x], fx[x]);
+		
+		t1 = _zoomLerpAVX2 (c00, c01, ex);
+		t2 = _zoomLerpAVX2 (c10, c11, ex);
+		t1 = _zoomLerpAVX2 (t1, t2, vey);
+		
+		/* Cada mitad trae dos pixeles en sus 8 bytes bajos */
+		t1 = _mm256_packus_epi16 (t1, t1);
+		t1 = _mm256_permute4x64_epi64 (t1, 0x08);
+		_mm_storeu_si128 ((__m128i *) &d[x], _mm256_castsi256_si128 (t1));
+	}
+	
+	if (x < w) {
+		_zoomRowRGBA_SSE2 (r0, r1, col0 + x, col1 + x, fx + x, ey, d + x, w - x);
+	}
+}
+#endif
+
+static ZoomRowFunc _zoomPickRow (void) {
+	static ZoomRowFunc row = NULL;
+	
+	if (row != NULL) return row;
+	
+	row = _zoomRowRGBA_C;
+#ifdef ZOOM_HAVE_SIMD
+	__builtin_cpu_init ();
+	if (__builtin_cpu_supports ("avx2")) {
+		row = _zoomRowRGBA_AVX2;
+	} else if (__builtin_cpu_supports ("sse2")) {
+		row = _zoomRowRGBA_SSE2;
+	}
+#endif
+	
+	return row;
+}
+
+static void _zoomBandRGBA (void *data, int band) {
+	ZoomJob *job = (ZoomJob *) data;
+	SDL_Surface *src = job->src, *dst = job->dst;
+	const Uint32 *base, *r0, *r1;
+	int y, last, cy, gap, spixelh;
+	
+	gap = src->pitch / 4;
+	spixelh = src->h - 1;
+	base = (const Uint32 *) src->pixels;
+	if (job->flipy) base += gap * spixelh;
+	
+	y = band * ZOOM_BAND_ROWS;
+	last = y + ZOOM_BAND_ROWS;
+	if (last > dst->h) last = dst->h;
+	
+	for (; y < last; y++) {
+		cy = job->say[y] >> 16;
+		r0 = base + (job->flipy ? -cy : cy) * gap;
+		r1 = r0;
+		if (cy < spixelh) {
+			r1 += (job->flipy ? -gap : gap);
+		}
+		
+		job->row (r0, r1, job->col0, job->col1, job->fx, job->say[y] & 0xffff, (Uint32 *) ((Uint8 *) dst->pixels + y * dst->pitch), dst->w);
+	}
+}
+
+static int _zoomSmoothRGBA (SDL_Surface * src, SDL_Surface * dst, int *sax, int *say, int flipx, int flipy) {
+	ZoomJob job;
+	int x, cx, spixelw, bands;
+	
+	if ((job.col0 = (int *) malloc (3 * dst->w * sizeof (int))) == NULL) {
+		return (-1);
+	}
+	job.col1 = job.col0 + dst->w;
+	job.fx = job.col1 + dst->w;
+	
+	spixelw = src->w - 1;
+	for (x = 0; x < dst->w; x++) {
+		cx = sax[x] >> 16;
+		job.fx[x] = sax[x] & 0xffff;
+		job.col0[x] = (flipx ? spixelw - cx : cx);
+		job.col1[x] = job.col0[x];
+		if (cx < spixelw) {
+			job.col1[x] += (flipx ? -1 : 1);
+		}
+	}
+	
+	job.src = src;
+	job.dst = dst;
+	job.say = say;
+	job.flipy = flipy;
+	job.row = _zoomPickRow ();
+	
+	bands = (dst->h + ZOOM_BAND_ROWS - 1) / ZOOM_BAND_ROWS;
+	if (dst->w * dst->h >= ZOOM_PARALLEL_PIXELS) {
+		workers_run (_zoomBandRGBA, &job, bands);
+	} else {
+		for (x = 0; x < bands; x++) {
+			_zoomBandRGBA (&job, x);
+		}
+	}
+	
+	free (job.col0);
+	
+	return (0);
+}
+
 int _zoomSurfaceRGBA(SDL_Surface * src, SDL_Surface * dst, int flipx, int flipy, int smooth) {
-	int x, y, sx, sy, ssx, ssy, *sax, *say, *csax, *csay, *salast, csx, csy, ex, ey, cx, cy, sstep, sstepx, sstepy;
-	tColorRGBA *c00, *c01, *c10, *c11;
+	int x, y, sx, sy, ssx, ssy, *sax, *say, *csax, *csay, *salast, csx, csy, sstep;
 	tColorRGBA *sp, *csp, *dp;
-	int spixelgap, spixelw, spixelh, dgap, t1, t2;
+	int spixelgap, spixelw, spixelh, dgap;
 
 	/*
 	* Allocate memory for row/column increments 
@@ -253,94 +502,13 @@ int _zoomSurfaceRGBA(SDL_Surface * src, SDL_Surface * dst, int flipx, int flipy,
 	* Switch between interpolating and non-interpolating code 
 	*/
 	if (smooth) {
-
 		/*
 		* Interpolating Zoom 
 		*/
-		csay = say;
-		for (y = 0; y < dst->h; y++) {
-			csp = sp;
-			csax = sax;
-			for (x = 0; x < dst->w; x++) {
-				/*
-				* Setup color source pointers 
-				*/
-				ex = (*csax & 0xffff);
-				ey = (*csay & 0xffff);
-				cx = (*csax >> 16);
-				cy = (*csay >> 16);
-				sstepx = cx < spixelw;
-				sstepy = cy < spixelh;
-				c00 = sp;
-				c01 = sp;
-				c10 = sp;
-				if (sstepy) {
-					if (flipy) {
-						c10 -= spixelgap;
-					} else {
-						c10 += spixelgap;
-					}
-				}
-				c11 = c10;
-				if (sstepx) {
-					if (flipx) {
-						c01--;
-						c11--;
-					} else {
-						c01++;
-						c11++;
-					}
-				}
-
-				/*
-				* Draw and interpolate colors 
-				*/
-				t1 = ((((c01->r - c00->r) * ex) >> 16) + c00->r) & 0xff;
-				t2 = ((((c11->r - c10->r) * ex) >> 16) + c10->r) & 0xff;
-				dp->r = (((t2 - t1) * ey) >> 16) + t1;
-				t1 = ((((c01->g - c00->g) * ex) >> 16) + c00->g) & 0xff;
-				t2 = ((((c11->g - c10->g) * ex) >> 16) + c10->g) & 0xff;
-				dp->g = (((t2 - t1) * ey) >> 16) + t1;
-				t1 = ((((c01->b - c00->b) * ex) >> 16) + c00->b) & 0xff;
-				t2 = ((((c11->b - c10->b) * ex) >> 16) + c10->b) & 0xff;
-				dp->b = (((t2 - t1) * ey) >> 16) + t1;
-				t1 = ((((c01->a - c00->a) * ex) >> 16) + c00->a) & 0xff;
-				t2 = ((((c11->a - c10->a) * ex) >> 16) + c10->a) & 0xff;
-				dp->a = (((t2 - t1) * ey) >> 16) + t1;				
-				/*
-				* Advance source pointer x
-				*/
-				salast = csax;
-				csax++;				
-				sstep = (*csax >> 16) - (*salast >> 16);
-				if (flipx) {
-					sp -= sstep;
-				} else {
-					sp += sstep;
-				}
-
-				/*
-				* Advance destination pointer x
-				*/
-				dp++;
-			}
-			/*
-			* Advance source pointer y
-			*/
-			salast = csay;
-			csay++;
-			sstep = (*csay >> 16) - (*salast >> 16);
-			sstep *= spixelgap;
-			if (flipy) { 
-				sp = csp - sstep;
-			} else {
-				sp = csp + sstep;
-			}
-
-			/*
-			* Advance destination pointer y
-			*/
-			dp = (tColorRGBA *) ((Uint8 *) dp + dgap);
+		if (_zoomSmoothRGBA (src, dst, sax, say, flipx, flipy) < 0) {
+			free(sax);
+			free(say);
+			return (-1);
 		}
 	} else {
 		/*
@@ -434,7 +602,7 @@ SDL_Surface *zoomSurface(SDL_Surface * src, double zoomx, double zoomy, int smoo
 	SDL_Surface *rz_dst;
 	int dstwidth, dstheight;
 	int is32bit;
-	int i, src_converted;
+	int i, src_converted, res;
 	int flipx, flipy;
 
 	/*
@@ -527,7 +695,9 @@ SDL_Surface *zoomSurface(SDL_Surface * src, double zoomx, double zoomy, int smoo
 		/*
 		* Call the 32bit transformation routine to do the zooming (using alpha) 
 		*/
-		_zoomSurfaceRGBA(rz_src, rz_dst, flipx, flipy, smooth);
+		PERF_BEGIN (PERF_REGION_ZOOM);
+		res = _zoomSurfaceRGBA(rz_src, rz_dst, flipx, flipy, smooth);
+		PERF_END (PERF_REGION_ZOOM);
 		/*
 		* Turn on source-alpha support 
 		*/
@@ -543,7 +713,7 @@ SDL_Surface *zoomSurface(SDL_Surface * src, double zoomx, double zoomy, int smoo
 		/*
 		* Call the 8bit transformation routine to do the zooming 
 		*/
-		_zoomSurfaceY(rz_src, rz_dst, flipx, flipy);
+		res = _zoomSurfaceY(rz_src, rz_dst, flipx, flipy);
 		SDL_SetColorKey(rz_dst, SDL_SRCCOLORKEY | SDL_RLEACCEL, _colorkey(rz_src));
 	}
 	/*
@@ -560,6 +730,12 @@ SDL_Surface *zoomSurface(SDL_Surface * src, double zoomx, double zoomy, int smoo
 		SDL_FreeSurface(rz_src);
 	}
 
+	/* Sin memoria para las tablas, la superficie quedó sin llenar */
+	if (res < 0) {
+		SDL_FreeSurface(rz_dst);
+		return NULL;
+	}
+
 	/*
 	* Return destination surface 
 	*/